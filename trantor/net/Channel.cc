@@ -100,7 +100,9 @@ void Channel::handleEventSafely()
 #ifdef _WIN32
     if ((revents_ & POLLOUT) && !(revents_ & POLLHUP))
 #else
-    if (revents_ & POLLOUT)
+    // Edge triggered channels are told about writability even when they don't
+    // wait for it
+    if ((revents_ & POLLOUT) && (!edgeTriggered_ || isWriting()))
 #endif
     {
         // LOG_TRACE<<"handle write";
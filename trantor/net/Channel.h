@@ -16,6 +16,7 @@
 
 #include <trantor/utils/Logger.h>
 #include <trantor/utils/NonCopyable.h>
+#include <trantor/net/ChannelPriority.h>
 #include <trantor/exports.h>
 #include <functional>
 #include <assert.h>
@@ -211,7 +212,9 @@ class TRANTOR_EXPORT Channel : NonCopyable
     void enableWriting()
     {
         events_ |= kWriteEvent;
-        update();
+        // An edge triggered channel always waits for writability in the poller
+        if (!edgeTriggered_)
+            update();
     }
 
     /**
@@ -221,7 +224,8 @@ class TRANTOR_EXPORT Channel : NonCopyable
     void disableWriting()
     {
         events_ &= ~kWriteEvent;
-        update();
+        if (!edgeTriggered_)
+            update();
     }
 
     /**
@@ -272,6 +276,53 @@ class TRANTOR_EXPORT Channel : NonCopyable
         tied_ = true;
     }
 
+    /**
+     * @brief Watch the socket in the edge triggered mode, it must be supported
+     * by the poller of the event loop. The channel is notified only when the
+     * state of the socket changes, so the read callback must read until EAGAIN
+     * and the write callback is called again only after a write has filled the
+     * socket. Enabling and disabling writing don't change the events watched
+     * by the poller in this mode.
+     *
+     * @param on
+     * @note This method must be called in the thread of the event loop.
+     */
+    void setEdgeTriggered(bool on)
+    {
+        edgeTriggered_ = on;
+        if (!isNoneEvent())
+            update();
+    }
+
+    /**
+     * @brief Check whether the socket is watched in the edge triggered mode.
+     */
+    bool isEdgeTriggered() const
+    {
+        return edgeTriggered_;
+    }
+
+    /**
+     * @brief Set the priority class of the channel. The events of channels with
+     * higher priority are handled first in an iteration of the event loop.
+     *
+     * @param priority
+     * @note This method must be called in the thread of the event loop.
+     */
+    void setPriority(ChannelPriority priority)
+    {
+        priority_ = priority;
+    }
+    /**
+     * @brief Return the priority class of the channel.
+     *
+     * @return ChannelPriority
+     */
+    ChannelPriority priority() const
+    {
+        return priority_;
+    }
+
     static const int kNoneEvent;
     static const int kReadEvent;
     static const int kWriteEvent;
@@ -279,6 +330,7 @@ class TRANTOR_EXPORT Channel : NonCopyable
   private:
     friend class EventLoop;
     friend class EpollPoller;
+    friend class IoUringPoller;
     friend class KQueue;
     friend class PollPoller;
     void update();
@@ -303,7 +355,9 @@ class TRANTOR_EXPORT Channel : NonCopyable
     int events_;
     int revents_;
     int index_;
+    ChannelPriority priority_{ChannelPriority::Normal};
     bool addedToLoop_{false};
+    bool edgeTriggered_{false};
     EventCallback readCallback_;
     EventCallback writeCallback_;
     EventCallback errorCallback_;
@@ -0,0 +1,32 @@
+/**
+ *
+ *  @file ChannelPriority.h
+ *  @author An Tao
+ *
+ *  Public header file in trantor lib.
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace trantor
+{
+/**
+ * @brief The priority classes of channels. In one iteration of an event loop,
+ * the events of higher priority channels are handled first.
+ */
+enum class ChannelPriority : uint8_t
+{
+    High = 0,  ///< Listeners, timers and control connections
+    Normal,    ///< The default
+    Low        ///< Bulk transfers
+};
+constexpr size_t kChannelPriorityCount = 3;
+}  // namespace trantor
@@ -20,6 +20,7 @@
 
 #include "Poller.h"
 #include "TimerQueue.h"
+#include "MemBufferNodePool.h"
 #include "Channel.h"
 
 #include <thread>
@@ -63,15 +64,19 @@ int createEventfd()
 const int kPollTimeMs = 10000;
 #endif
 thread_local EventLoop *t_loopInThisThread = nullptr;
+static std::atomic<PollerBackend> s_pollerBackend{PollerBackend::Default};
 
 EventLoop::EventLoop()
     : looping_(false),
       threadId_(std::this_thread::get_id()),
       quit_(false),
-      poller_(Poller::newPoller(this)),
+      poller_(Poller::newPoller(
+          this,
+          s_pollerBackend.load(std::memory_order_relaxed))),
       currentActiveChannel_(nullptr),
       eventHandling_(false),
       timerQueue_(new TimerQueue(this)),
+      bufferNodePool_(new MemBufferNodePool),
 #ifdef __linux__
       wakeupFd_(createEventfd()),
       wakeupChannelPtr_(new Channel(this, wakeupFd_)),
@@ -217,26 +222,37 @@ void EventLoop::loop()
         while (!quit_.load(std::memory_order_acquire))
         {
             activeChannels_.clear();
+            // Don't block if the last iteration left functions to run
 #ifdef __linux__
-            poller_->poll(kPollTimeMs, &activeChannels_);
+            int timeout = funcsLeft_ ? 0 : kPollTimeMs;
 #else
-            poller_->poll(static_cast<int>(timerQueue_->getTimeout()),
-                          &activeChannels_);
+            int timeout =
+                funcsLeft_ ? 0 : static_cast<int>(timerQueue_->getTimeout());
+#endif
+            if (timeout == 0 || !busyPoll(timeout))
+            {
+#ifndef __linux__
+                // Spinning took some time from the next timer
+                if (timeout != 0)
+                    timeout = static_cast<int>(timerQueue_->getTimeout());
+#endif
+                if (timeout != 0)
+                    blockingWaits_.store(
+                        blockingWaits_.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+                poller_->poll(timeout, &activeChannels_);
+            }
+#ifndef __linux__
             timerQueue_->processTimers();
 #endif
-            // TODO sort channel by priority
             // std::cout<<"after ->poll()"<<std::endl;
             eventHandling_ = true;
-            for (auto it = activeChannels_.begin(); it != activeChannels_.end();
-                 ++it)
-            {
-                currentActiveChannel_ = *it;
-                currentActiveChannel_->handleEvent();
-            }
+            handleActiveChannels();
             currentActiveChannel_ = nullptr;
             eventHandling_ = false;
             // std::cout << "looping" << endl;
             doRunInLoopFuncs();
+            doRunAfterDispatchFuncs();
         }
         // loopFlagCleaner clears the loop flag here
     }
@@ -251,7 +267,7 @@ void EventLoop::loop()
     // Run the quit functions even if exceptions were thrown
     // TODO: if more exceptions are thrown in the quit functions, some are left
     // un-run. Can this be made exception safe?
-    Func f;
+    LoopFunc f;
     while (funcsOnQuit_.dequeue(f))
     {
         f();
@@ -264,39 +280,70 @@ void EventLoop::loop()
         std::rethrow_exception(loopException);
     }
 }
+void EventLoop::handleActiveChannels()
+{
+    // Most iterations only see channels of one priority, they are handled in
+    // the order the poller returned them.
+    unsigned int seen = 0;
+    for (auto channel : activeChannels_)
+    {
+        seen |= 1u << static_cast<unsigned int>(channel->priority());
+    }
+    if ((seen & (seen - 1)) == 0)
+    {
+        for (auto channel : activeChannels_)
+        {
+            currentActiveChannel_ = channel;
+            currentActiveChannel_->handleEvent();
+        }
+        return;
+    }
+    for (auto channel : activeChannels_)
+    {
+        priorityBuckets_[static_cast<size_t>(channel->priority())].push_back(
+            channel);
+    }
+    for (auto &bucket : priorityBuckets_)
+    {
+        for (auto channel : bucket)
+        {
+            currentActiveChannel_ = channel;
+            currentActiveChannel_->handleEvent();
+        }
+        bucket.clear();
+    }
+}
 void EventLoop::abortNotInLoopThread()
 {
     LOG_FATAL << "It is forbidden to run loop on threads other than event-loop "
                  "thread";
     exit(1);
 }
-void EventLoop::queueInLoop(const Func &cb)
-{
-    funcs_.enqueue(cb);
-    if (!isInLoopThread() || !looping_.load(std::memory_order_acquire))
-    {
-        wakeup();
-    }
-}
-void EventLoop::queueInLoop(Func &&cb)
+void EventLoop::queueInLoop(LoopFunc &&cb)
 {
     funcs_.enqueue(std::move(cb));
     if (!isInLoopThread() || !looping_.load(std::memory_order_acquire))
     {
-        wakeup();
+        // Only the first producer after the loop has taken the pending
+        // wakeup writes to the wakeup fd, the others find their functions
+        // when the loop drains the queue.
+        if (!wakeupPending_.exchange(true, std::memory_order_acq_rel))
+            wakeup();
     }
 }
 
-TimerId EventLoop::runAt(const Date &time, const Func &cb)
+// The Func overloads are the signatures of the library before LoopFunc, they
+// are kept so that binaries built against it still link
+void EventLoop::queueInLoop(const Func &cb)
 {
-    auto microSeconds =
-        time.microSecondsSinceEpoch() - Date::now().microSecondsSinceEpoch();
-    std::chrono::steady_clock::time_point tp =
-        std::chrono::steady_clock::now() +
-        std::chrono::microseconds(microSeconds);
-    return timerQueue_->addTimer(cb, tp, std::chrono::microseconds(0));
+    queueInLoop(LoopFunc(cb));
 }
-TimerId EventLoop::runAt(const Date &time, Func &&cb)
+void EventLoop::queueInLoop(Func &&cb)
+{
+    queueInLoop(LoopFunc(std::move(cb)));
+}
+
+TimerId EventLoop::runAt(const Date &time, LoopFunc &&cb)
 {
     auto microSeconds =
         time.microSecondsSinceEpoch() - Date::now().microSecondsSinceEpoch();
@@ -307,27 +354,40 @@ TimerId EventLoop::runAt(const Date &time, Func &&cb)
                                  tp,
                                  std::chrono::microseconds(0));
 }
+TimerId EventLoop::runAt(const Date &time, const Func &cb)
+{
+    return runAt(time, LoopFunc(cb));
+}
+TimerId EventLoop::runAt(const Date &time, Func &&cb)
+{
+    return runAt(time, LoopFunc(std::move(cb)));
+}
+TimerId EventLoop::runAfter(double delay, LoopFunc &&cb)
+{
+    return runAt(Date::date().after(delay), std::move(cb));
+}
 TimerId EventLoop::runAfter(double delay, const Func &cb)
 {
-    return runAt(Date::date().after(delay), cb);
+    return runAfter(delay, LoopFunc(cb));
 }
 TimerId EventLoop::runAfter(double delay, Func &&cb)
 {
-    return runAt(Date::date().after(delay), std::move(cb));
+    return runAfter(delay, LoopFunc(std::move(cb)));
 }
-TimerId EventLoop::runEvery(double interval, const Func &cb)
+TimerId EventLoop::runEvery(double interval, LoopFunc &&cb)
 {
     std::chrono::microseconds dur(
         static_cast<std::chrono::microseconds::rep>(interval * 1000000));
     auto tp = std::chrono::steady_clock::now() + dur;
-    return timerQueue_->addTimer(cb, tp, dur);
+    return timerQueue_->addTimer(std::move(cb), tp, dur);
+}
+TimerId EventLoop::runEvery(double interval, const Func &cb)
+{
+    return runEvery(interval, LoopFunc(cb));
 }
 TimerId EventLoop::runEvery(double interval, Func &&cb)
 {
-    std::chrono::microseconds dur(
-        static_cast<std::chrono::microseconds::rep>(interval * 1000000));
-    auto tp = std::chrono::steady_clock::now() + dur;
-    return timerQueue_->addTimer(std::move(cb), tp, dur);
+    return runEvery(interval, LoopFunc(std::move(cb)));
 }
 void EventLoop::invalidateTimer(TimerId id)
 {
@@ -336,6 +396,9 @@ void EventLoop::invalidateTimer(TimerId id)
 }
 void EventLoop::doRunInLoopFuncs()
 {
+    // Clear the flag before draining, so a function enqueued after this point
+    // either is seen by the drain below or wakes the loop up again.
+    wakeupPending_.exchange(false, std::memory_order_acq_rel);
     callingFuncs_ = true;
     {
         // Assure the flag is cleared even if func throws
@@ -346,16 +409,54 @@ void EventLoop::doRunInLoopFuncs()
         // TODO: The following is exception-unsafe. If one  of the funcs throws,
         // the remaining ones will not get run. The simplest fix is to catch any
         // exceptions and rethrow them later, but somehow that seems fishy...
+        const size_t maxCount =
+            funcsBudgetCount_.load(std::memory_order_relaxed);
+        const auto maxTime = std::chrono::microseconds(
+            funcsBudgetTime_.load(std::memory_order_relaxed));
+        const auto start = maxTime.count() > 0
+                               ? std::chrono::steady_clock::now()
+                               : std::chrono::steady_clock::time_point();
+        size_t count = 0;
+        funcsLeft_ = false;
         while (!funcs_.empty())
         {
-            Func func;
+            LoopFunc func;
             while (funcs_.dequeue(func))
             {
                 func();
+                ++count;
+                if ((maxCount > 0 && count >= maxCount) ||
+                    (maxTime.count() > 0 &&
+                     std::chrono::steady_clock::now() - start >= maxTime))
+                {
+                    funcsLeft_ = !funcs_.empty();
+                    return;
+                }
             }
         }
     }
 }
+bool EventLoop::busyPoll(int timeoutMs)
+{
+    auto spinTime =
+        std::chrono::microseconds(busyPollTime_.load(std::memory_order_relaxed));
+    if (spinTime.count() <= 0)
+        return false;
+    if (timeoutMs > 0 && spinTime > std::chrono::milliseconds(timeoutMs))
+        spinTime = std::chrono::milliseconds(timeoutMs);
+    auto deadline = std::chrono::steady_clock::now() + spinTime;
+    do
+    {
+        poller_->spinPoll(&activeChannels_);
+        if (!activeChannels_.empty())
+        {
+            spinHits_.store(spinHits_.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+            return true;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
 void EventLoop::wakeup()
 {
     // if (!looping_)
@@ -410,14 +511,94 @@ void EventLoop::moveToCurrentThread()
     threadId_ = std::this_thread::get_id();
 }
 
-void EventLoop::runOnQuit(Func &&cb)
+void EventLoop::runOnQuit(LoopFunc &&cb)
 {
     funcsOnQuit_.enqueue(std::move(cb));
 }
-
 void EventLoop::runOnQuit(const Func &cb)
 {
-    funcsOnQuit_.enqueue(cb);
+    runOnQuit(LoopFunc(cb));
+}
+void EventLoop::runOnQuit(Func &&cb)
+{
+    runOnQuit(LoopFunc(std::move(cb)));
+}
+
+void EventLoop::setBufferNodePoolCapacity(size_t maxNodes)
+{
+    bufferNodePool_->setCapacity(maxNodes);
+}
+
+size_t EventLoop::pooledBufferNodes() const
+{
+    return bufferNodePool_->size();
+}
+
+uint64_t EventLoop::bufferNodePoolHits() const
+{
+    return bufferNodePool_->hits();
+}
+
+uint64_t EventLoop::bufferNodePoolMisses() const
+{
+    return bufferNodePool_->misses();
+}
+
+void EventLoop::setPollerBackend(PollerBackend backend)
+{
+    s_pollerBackend.store(backend, std::memory_order_relaxed);
+}
+
+PollerBackend EventLoop::pollerBackend() const
+{
+    return poller_->backend();
+}
+
+bool EventLoop::supportsEdgeTriggered() const
+{
+    return poller_->supportsEdgeTriggered();
+}
+
+uint64_t EventLoop::pollerUpdates() const
+{
+    return poller_->interestUpdates();
+}
+
+void EventLoop::setPollEventsBatchSize(size_t minSize, size_t maxSize)
+{
+    runInLoop([this, minSize, maxSize]() {
+        poller_->setEventBatchSize(minSize, maxSize);
+    });
+}
+
+PollEventsHistogram EventLoop::pollEventsHistogram() const
+{
+    return poller_->pollEventsHistogram();
+}
+
+uint64_t EventLoop::saturatedPolls() const
+{
+    return poller_->saturatedPolls();
+}
+
+void EventLoop::runAfterDispatch(LoopFunc &&cb)
+{
+    assertInLoopThread();
+    afterDispatchFuncs_.push_back(std::move(cb));
+}
+
+void EventLoop::doRunAfterDispatchFuncs()
+{
+    // Functions added by the running ones are run in this iteration too
+    while (!afterDispatchFuncs_.empty())
+    {
+        runningAfterDispatchFuncs_.swap(afterDispatchFuncs_);
+        for (auto &func : runningAfterDispatchFuncs_)
+        {
+            func();
+        }
+        runningAfterDispatchFuncs_.clear();
+    }
 }
 
 }  // namespace trantor
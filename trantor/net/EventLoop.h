@@ -19,6 +19,8 @@
 #include <trantor/utils/NonCopyable.h>
 #include <trantor/utils/Date.h>
 #include <trantor/utils/LockFreeQueue.h>
+#include <trantor/utils/MoveOnlyFunction.h>
+#include <trantor/net/ChannelPriority.h>
 #include <trantor/exports.h>
 #include <thread>
 #include <memory>
@@ -29,20 +31,54 @@
 #include <chrono>
 #include <limits>
 #include <atomic>
+#include <array>
+#include <type_traits>
 
 namespace trantor
 {
 class Poller;
 class TimerQueue;
 class Channel;
+class MemBufferNodePool;
 using ChannelList = std::vector<Channel *>;
 using Func = std::function<void()>;
+/**
+ * @brief The type of functions run by an event loop. It accepts any callable,
+ * including Func objects, and stores small ones without allocating.
+ */
+using LoopFunc = MoveOnlyFunction<void()>;
+/**
+ * @brief Selects the overloads that wrap other callables into a LoopFunc.
+ * Func objects take the overloads kept for binary compatibility.
+ */
+template <typename F>
+using EnableIfLoopFunctor = typename std::enable_if<
+    !std::is_same<typename std::decay<F>::type, Func>::value &&
+    !std::is_same<typename std::decay<F>::type, LoopFunc>::value>::type;
 using TimerId = uint64_t;
 enum
 {
     InvalidTimerId = 0
 };
 
+/**
+ * @brief The I/O multiplexing backends of event loops.
+ */
+enum class PollerBackend : uint8_t
+{
+    Default = 0,  ///< epoll on Linux and Windows, kqueue on BSD and macOS
+    IoUring       ///< io_uring on Linux, with fallback to the default one
+};
+
+/**
+ * @brief The histogram of the number of events returned by each poll (e.g.
+ * each epoll_wait() call). Bucket 0 counts the polls without events, bucket i
+ * (i > 0) those with 2^(i-1) to 2^i - 1 events, and the last bucket also
+ * counts all the larger numbers.
+ */
+constexpr size_t kPollEventsBuckets = 14;
+using PollEventsHistogram = std::array<uint64_t, kPollEventsBuckets>;
+
 /**
  * @brief As the name implies, this class represents an event loop that runs in
  * a perticular thread. The event loop can handle network I/O events and timers
@@ -115,6 +151,20 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
      */
     static EventLoop *getEventLoopOfCurrentThread();
 
+    /**
+     * @brief Set the poller backend of the event loops constructed after the
+     * call. If the backend is not available (e.g. the kernel doesn't support
+     * io_uring), the default one is used.
+     *
+     * @param backend
+     */
+    static void setPollerBackend(PollerBackend backend);
+
+    /**
+     * @brief Return the poller backend of the event loop.
+     */
+    PollerBackend pollerBackend() const;
+
     /**
      * @brief Run the function f in the thread of the event loop.
      *
@@ -143,6 +193,12 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
      * that the function f is executed after the method exiting no matter if the
      * current thread is the thread of the event loop.
      */
+    void queueInLoop(LoopFunc &&f);
+    template <typename Functor, typename = EnableIfLoopFunctor<Functor>>
+    void queueInLoop(Functor &&f)
+    {
+        queueInLoop(LoopFunc(std::forward<Functor>(f)));
+    }
     void queueInLoop(const Func &f);
     void queueInLoop(Func &&f);
 
@@ -153,6 +209,12 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
      * @param cb The function to run.
      * @return TimerId The ID of the timer.
      */
+    TimerId runAt(const Date &time, LoopFunc &&cb);
+    template <typename Functor, typename = EnableIfLoopFunctor<Functor>>
+    TimerId runAt(const Date &time, Functor &&cb)
+    {
+        return runAt(time, LoopFunc(std::forward<Functor>(cb)));
+    }
     TimerId runAt(const Date &time, const Func &cb);
     TimerId runAt(const Date &time, Func &&cb);
 
@@ -163,6 +225,12 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
      * @param cb The function to run.
      * @return TimerId The ID of the timer.
      */
+    TimerId runAfter(double delay, LoopFunc &&cb);
+    template <typename Functor, typename = EnableIfLoopFunctor<Functor>>
+    TimerId runAfter(double delay, Functor &&cb)
+    {
+        return runAfter(delay, LoopFunc(std::forward<Functor>(cb)));
+    }
     TimerId runAfter(double delay, const Func &cb);
     TimerId runAfter(double delay, Func &&cb);
 
@@ -175,11 +243,8 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
        runAfter(10min, task);
        @endcode
      */
-    TimerId runAfter(const std::chrono::duration<double> &delay, const Func &cb)
-    {
-        return runAfter(delay.count(), cb);
-    }
-    TimerId runAfter(const std::chrono::duration<double> &delay, Func &&cb)
+    TimerId runAfter(const std::chrono::duration<double> &delay,
+                     LoopFunc &&cb)
     {
         return runAfter(delay.count(), std::move(cb));
     }
@@ -191,6 +256,12 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
      * @param cb The function to run.
      * @return TimerId The ID of the timer.
      */
+    TimerId runEvery(double interval, LoopFunc &&cb);
+    template <typename Functor, typename = EnableIfLoopFunctor<Functor>>
+    TimerId runEvery(double interval, Functor &&cb)
+    {
+        return runEvery(interval, LoopFunc(std::forward<Functor>(cb)));
+    }
     TimerId runEvery(double interval, const Func &cb);
     TimerId runEvery(double interval, Func &&cb);
 
@@ -205,11 +276,7 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
        @endcode
      */
     TimerId runEvery(const std::chrono::duration<double> &interval,
-                     const Func &cb)
-    {
-        return runEvery(interval.count(), cb);
-    }
-    TimerId runEvery(const std::chrono::duration<double> &interval, Func &&cb)
+                     LoopFunc &&cb)
     {
         return runEvery(interval.count(), std::move(cb));
     }
@@ -292,26 +359,252 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
      * @param cb the function to run
      * @note the function runs on the thread that quits the EventLoop
      */
-    void runOnQuit(Func &&cb);
+    void runOnQuit(LoopFunc &&cb);
+    template <typename Functor, typename = EnableIfLoopFunctor<Functor>>
+    void runOnQuit(Functor &&cb)
+    {
+        runOnQuit(LoopFunc(std::forward<Functor>(cb)));
+    }
     void runOnQuit(const Func &cb);
+    void runOnQuit(Func &&cb);
+
+    /**
+     * @brief Run a function once the I/O events and the queued functions of
+     * the current loop iteration are handled, e.g. to flush data collected
+     * during the iteration.
+     *
+     * @param cb the function to run
+     * @note This method must be called in the loop thread.
+     */
+    void runAfterDispatch(LoopFunc &&cb);
+
+    /**
+     * @name Tuning
+     * The knobs of the loop iteration, the write buffer pool and the poller,
+     * they can be set from any thread.
+     * @{
+     */
+
+    /**
+     * @brief Limit the number of functions queued by queueInLoop() that are run
+     * in one iteration of the event loop. When the budget is used up, the loop
+     * polls I/O events without blocking before it runs the remaining
+     * functions, so a flood of functions can't starve the sockets.
+     *
+     * @param maxCount The maximum number of functions run per iteration, 0
+     * means no limit (the default).
+     * @param maxTime The maximum time spent running functions per iteration,
+     * 0 means no limit (the default).
+     * @note This method is thread safe.
+     */
+    void setFuncsBudget(size_t maxCount,
+                        const std::chrono::microseconds &maxTime =
+                            std::chrono::microseconds(0))
+    {
+        funcsBudgetCount_.store(maxCount, std::memory_order_relaxed);
+        funcsBudgetTime_.store(maxTime.count(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Enable the busy poll mode. Before blocking in the poller, the
+     * event loop polls without blocking for the given time, which cuts the
+     * wakeup latency at the cost of burning CPU while idle.
+     *
+     * @param spinTime The time to spin before blocking, 0 disables the busy
+     * poll mode (the default).
+     * @param socketBusyPoll If true, SO_BUSY_POLL is also set to spinTime on
+     * the sockets of TCP connections created in this event loop afterwards.
+     * Values above the net.core.busy_read sysctl need CAP_NET_ADMIN.
+     * @note This method is thread safe.
+     */
+    void setBusyPollTime(const std::chrono::microseconds &spinTime,
+                         bool socketBusyPoll = false)
+    {
+        busyPollTime_.store(spinTime.count(), std::memory_order_relaxed);
+        socketBusyPoll_.store(socketBusyPoll, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the spin time of the busy poll mode.
+     */
+    std::chrono::microseconds busyPollTime() const
+    {
+        return std::chrono::microseconds(
+            busyPollTime_.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Return true if SO_BUSY_POLL is set on new connection sockets.
+     */
+    bool socketBusyPoll() const
+    {
+        return socketBusyPoll_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Set the maximum number of idle write buffer nodes kept by the
+     * event loop for reuse by its TCP connections, 0 disables the pooling.
+     * The default value is 1024.
+     *
+     * @param maxNodes
+     */
+    void setBufferNodePoolCapacity(size_t maxNodes);
+
+    /**
+     * @brief Set the range of the number of events fetched by one poll. The
+     * event array of the poller grows up to maxSize when a poll fills it and
+     * shrinks down to minSize when polls keep using a small part of it. The
+     * default range is 16 to 4096.
+     *
+     * @param minSize
+     * @param maxSize
+     * @note This method is thread safe. Only the epoll and kqueue pollers
+     * fetch events into an array.
+     */
+    void setPollEventsBatchSize(size_t minSize, size_t maxSize);
+
+    /**
+     * @brief Return true if the poller of the event loop can watch channels in
+     * the edge triggered mode (epoll on Linux).
+     */
+    bool supportsEdgeTriggered() const;
+
+    /** @} */
+
+    /**
+     * @name Statistics
+     * The counters of the event loop, they can be read from any thread.
+     * @{
+     */
+
+    /**
+     * @brief Return the number of times events were found while spinning in
+     * the busy poll mode.
+     */
+    uint64_t spinHits() const
+    {
+        return spinHits_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the number of times the event loop blocked in the poller
+     * waiting for events.
+     */
+    uint64_t blockingWaits() const
+    {
+        return blockingWaits_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the number of live TCP connections handled by the event
+     * loop.
+     */
+    size_t connectionCount() const
+    {
+        return connectionCount_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the number of bytes buffered by the TCP connections of the
+     * event loop and waiting to be written to their sockets.
+     */
+    int64_t pendingBytes() const
+    {
+        return pendingBytes_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the number of idle write buffer nodes kept for reuse.
+     */
+    size_t pooledBufferNodes() const;
+
+    /**
+     * @brief Return the number of write buffer nodes taken from the pool and
+     * the number of those allocated because the pool was empty.
+     */
+    uint64_t bufferNodePoolHits() const;
+    uint64_t bufferNodePoolMisses() const;
+
+    /**
+     * @brief Return the number of system calls made to change the events
+     * watched by the poller, i.e. epoll_ctl() calls on Linux.
+     */
+    uint64_t pollerUpdates() const;
+
+    /**
+     * @brief Return the histogram of the number of events returned by each
+     * poll. The polls made while spinning in the busy poll mode are not
+     * included, they are counted by spinHits().
+     */
+    PollEventsHistogram pollEventsHistogram() const;
+
+    /**
+     * @brief Return the number of polls which filled the event array at its
+     * maximum size, a loop seeing many of them is saturated.
+     */
+    uint64_t saturatedPolls() const;
+
+    /**
+     * @brief Update the connection statistics. This method is usually used
+     * internally.
+     *
+     * @param connections The change of the number of connections.
+     * @param bytes The change of the pending bytes.
+     */
+    void updateConnectionStats(int64_t connections, int64_t bytes)
+    {
+        if (connections != 0)
+            connectionCount_.fetch_add(static_cast<size_t>(connections),
+                                       std::memory_order_relaxed);
+        if (bytes != 0)
+            pendingBytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /** @} */
 
   private:
+    friend class TcpConnectionImpl;
+    // The pool of the write buffer nodes of the connections of the loop
+    MemBufferNodePool &bufferNodePool()
+    {
+        return *bufferNodePool_;
+    }
     void abortNotInLoopThread();
     void wakeup();
     void wakeupRead();
+    bool busyPoll(int timeoutMs);
+    void handleActiveChannels();
     std::atomic<bool> looping_;
     std::thread::id threadId_;
     std::atomic<bool> quit_;
     std::unique_ptr<Poller> poller_;
 
     ChannelList activeChannels_;
+    // Active channels of each priority, used when priorities are mixed
+    ChannelList priorityBuckets_[kChannelPriorityCount];
     Channel *currentActiveChannel_;
 
     bool eventHandling_;
-    MpscQueue<Func> funcs_;
+    MpscQueue<LoopFunc> funcs_;
     std::unique_ptr<TimerQueue> timerQueue_;
-    MpscQueue<Func> funcsOnQuit_;
+    MpscQueue<LoopFunc> funcsOnQuit_;
     bool callingFuncs_{false};
+    std::vector<LoopFunc> afterDispatchFuncs_;
+    std::vector<LoopFunc> runningAfterDispatchFuncs_;
+    // Set while a wakeup has been sent and the loop has not drained funcs_
+    std::atomic<bool> wakeupPending_{false};
+    std::atomic<size_t> funcsBudgetCount_{0};
+    std::atomic<std::chrono::microseconds::rep> funcsBudgetTime_{0};
+    // Set when the budget left functions in funcs_
+    bool funcsLeft_{false};
+    std::atomic<std::chrono::microseconds::rep> busyPollTime_{0};
+    std::atomic<bool> socketBusyPoll_{false};
+    // Only written by the loop thread
+    std::atomic<uint64_t> spinHits_{0};
+    std::atomic<uint64_t> blockingWaits_{0};
+    std::atomic<size_t> connectionCount_{0};
+    std::atomic<int64_t> pendingBytes_{0};
+    std::unique_ptr<MemBufferNodePool> bufferNodePool_;
 #ifdef __linux__
     int wakeupFd_;
     std::unique_ptr<Channel> wakeupChannelPtr_;
@@ -322,6 +615,7 @@ class TRANTOR_EXPORT EventLoop : NonCopyable
 #endif
 
     void doRunInLoopFuncs();
+    void doRunAfterDispatchFuncs();
 #ifdef _WIN32
     size_t index_{size_t(-1)};
 #else
@@ -16,6 +16,9 @@
 #include <trantor/utils/Logger.h>
 #ifdef __linux__
 #include <sys/prctl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
 #endif
 
 using namespace trantor;
@@ -78,3 +81,31 @@ void EventLoopThread::run()
         (void)f.get();
     });
 }
+
+bool EventLoopThread::pinToCpu(int cpu)
+{
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        LOG_ERROR << "Invalid CPU index " << cpu;
+        return false;
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    int ret =
+        pthread_setaffinity_np(thread_.native_handle(), sizeof(cpuSet), &cpuSet);
+    if (ret != 0)
+    {
+        errno = ret;
+        LOG_SYSERR << "Failed to pin " << loopThreadName_ << " to CPU " << cpu;
+        return false;
+    }
+    cpu_.store(cpu, std::memory_order_release);
+    return true;
+#else
+    (void)cpu;
+    LOG_ERROR << "CPU affinity is not supported on this platform";
+    return false;
+#endif
+}
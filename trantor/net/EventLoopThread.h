@@ -17,6 +17,7 @@
 #include <trantor/net/EventLoop.h>
 #include <trantor/utils/NonCopyable.h>
 #include <trantor/exports.h>
+#include <atomic>
 #include <mutex>
 #include <thread>
 #include <memory>
@@ -58,6 +59,24 @@ class TRANTOR_EXPORT EventLoopThread : NonCopyable
      */
     void run();
 
+    /**
+     * @brief Pin the thread to a CPU.
+     *
+     * @param cpu The index of the CPU.
+     * @return true if the affinity is set.
+     * @note Only supported on Linux, false is returned on other platforms.
+     */
+    bool pinToCpu(int cpu);
+
+    /**
+     * @brief Return the CPU the thread is pinned to, or -1 if it is not
+     * pinned.
+     */
+    int cpu() const
+    {
+        return cpu_.load(std::memory_order_acquire);
+    }
+
   private:
     // With C++20, use std::atomic<std::shared_ptr<EventLoop>>
     std::shared_ptr<EventLoop> loop_;
@@ -69,6 +88,7 @@ class TRANTOR_EXPORT EventLoopThread : NonCopyable
     std::promise<int> promiseForRun_;
     std::promise<int> promiseForLoop_;
     std::once_flag once_;
+    std::atomic<int> cpu_{-1};
     std::thread thread_;
 };
 
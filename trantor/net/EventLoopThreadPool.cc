@@ -13,14 +13,128 @@
  */
 
 #include <trantor/net/EventLoopThreadPool.h>
+#include <trantor/utils/Logger.h>
+#ifdef __linux__
+#include <fstream>
+#include <sched.h>
+#endif
 using namespace trantor;
+
+#ifdef __linux__
+namespace
+{
+// Parse a sysfs CPU list like "0-3,8,10-11"
+std::vector<int> parseCpuList(const std::string &path)
+{
+    std::vector<int> cpus;
+    std::ifstream file(path);
+    std::string list;
+    if (!std::getline(file, list))
+        return cpus;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        auto end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        auto range = list.substr(pos, end - pos);
+        auto dash = range.find('-');
+        try
+        {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos
+                           ? first
+                           : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        catch (...)
+        {
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+// The CPUs of each NUMA node, indexed by node, empty if NUMA info is missing
+std::vector<std::vector<int>> numaNodeCpus()
+{
+    std::vector<std::vector<int>> nodes;
+    for (int node : parseCpuList("/sys/devices/system/node/online"))
+    {
+        if (nodes.size() <= static_cast<size_t>(node))
+            nodes.resize(node + 1);
+        nodes[node] = parseCpuList("/sys/devices/system/node/node" +
+                                   std::to_string(node) + "/cpulist");
+    }
+    return nodes;
+}
+
+std::vector<int> numaAwareCpuLayout()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        LOG_SYSERR << "sched_getaffinity";
+        return {};
+    }
+    auto nodes = numaNodeCpus();
+    if (nodes.empty())
+    {
+        nodes.resize(1);
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            nodes[0].push_back(cpu);
+    }
+    // In every node, the first hyper-thread of each core comes first
+    std::vector<std::vector<int>> nodeLayouts;
+    for (auto &cpus : nodes)
+    {
+        std::vector<int> cores, siblings;
+        for (int cpu : cpus)
+        {
+            if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed))
+                continue;
+            auto threads = parseCpuList("/sys/devices/system/cpu/cpu" +
+                                        std::to_string(cpu) +
+                                        "/topology/thread_siblings_list");
+            if (threads.empty() || threads[0] == cpu)
+                cores.push_back(cpu);
+            else
+                siblings.push_back(cpu);
+        }
+        cores.insert(cores.end(), siblings.begin(), siblings.end());
+        if (!cores.empty())
+            nodeLayouts.push_back(std::move(cores));
+    }
+    // Take the nodes in turn
+    std::vector<int> layout;
+    for (size_t i = 0;; ++i)
+    {
+        bool added = false;
+        for (auto &cpus : nodeLayouts)
+        {
+            if (i < cpus.size())
+            {
+                layout.push_back(cpus[i]);
+                added = true;
+            }
+        }
+        if (!added)
+            break;
+    }
+    return layout;
+}
+}  // namespace
+#endif
+
 EventLoopThreadPool::EventLoopThreadPool(size_t threadNum,
                                          const std::string &name)
-    : loopIndex_(0)
 {
     for (size_t i = 0; i < threadNum; ++i)
     {
         loopThreadVector_.emplace_back(std::make_shared<EventLoopThread>(name));
+        loops_.push_back(loopThreadVector_.back()->getLoop());
     }
 }
 void EventLoopThreadPool::start()
@@ -45,12 +159,17 @@ void EventLoopThreadPool::wait()
 }
 EventLoop *EventLoopThreadPool::getNextLoop()
 {
-    if (loopThreadVector_.size() > 0)
+    if (loops_.size() > 0)
+    {
+        return loopSelector_.select(loops_);
+    }
+    return nullptr;
+}
+EventLoop *EventLoopThreadPool::getNextLoop(const InetAddress &peer)
+{
+    if (loops_.size() > 0)
     {
-        size_t index = loopIndex_.fetch_add(1, std::memory_order_relaxed);
-        EventLoop *loop =
-            loopThreadVector_[index % loopThreadVector_.size()]->getLoop();
-        return loop;
+        return loopSelector_.select(loops_, &peer);
     }
     return nullptr;
 }
@@ -68,4 +187,75 @@ std::vector<EventLoop *> EventLoopThreadPool::getLoops() const
         ret.push_back(loopThread->getLoop());
     }
     return ret;
-}
\ No newline at end of file
+}
+void EventLoopThreadPool::setFuncsBudget(
+    size_t maxCount,
+    const std::chrono::microseconds &maxTime)
+{
+    for (auto &loopThread : loopThreadVector_)
+    {
+        loopThread->getLoop()->setFuncsBudget(maxCount, maxTime);
+    }
+}
+void EventLoopThreadPool::setBusyPollTime(
+    const std::chrono::microseconds &spinTime,
+    bool socketBusyPoll)
+{
+    for (auto &loopThread : loopThreadVector_)
+    {
+        loopThread->getLoop()->setBusyPollTime(spinTime, socketBusyPoll);
+    }
+}
+void EventLoopThreadPool::setPollEventsBatchSize(size_t minSize,
+                                                 size_t maxSize)
+{
+    for (auto &loopThread : loopThreadVector_)
+    {
+        loopThread->getLoop()->setPollEventsBatchSize(minSize, maxSize);
+    }
+}
+bool EventLoopThreadPool::setCpuAffinity(const std::vector<int> &cpus)
+{
+#ifdef __linux__
+    auto layout = cpus.empty() ? numaAwareCpuLayout() : cpus;
+    if (layout.empty())
+        return false;
+    bool ret = true;
+    for (size_t i = 0; i < loopThreadVector_.size(); ++i)
+    {
+        if (!loopThreadVector_[i]->pinToCpu(layout[i % layout.size()]))
+            ret = false;
+    }
+    return ret;
+#else
+    (void)cpus;
+    LOG_ERROR << "CPU affinity is not supported on this platform";
+    return false;
+#endif
+}
+int EventLoopThreadPool::getLoopCpu(size_t id) const
+{
+    if (id < loopThreadVector_.size())
+        return loopThreadVector_[id]->cpu();
+    return -1;
+}
+int EventLoopThreadPool::getLoopNumaNode(size_t id) const
+{
+#ifdef __linux__
+    int cpu = getLoopCpu(id);
+    if (cpu < 0)
+        return -1;
+    auto nodes = numaNodeCpus();
+    for (size_t node = 0; node < nodes.size(); ++node)
+    {
+        for (int c : nodes[node])
+        {
+            if (c == cpu)
+                return static_cast<int>(node);
+        }
+    }
+#else
+    (void)id;
+#endif
+    return -1;
+}
@@ -15,10 +15,12 @@
 #pragma once
 
 #include <trantor/net/EventLoopThread.h>
+#include <trantor/net/LoopSelector.h>
 #include <trantor/exports.h>
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <chrono>
 
 namespace trantor
 {
@@ -64,12 +66,39 @@ class TRANTOR_EXPORT EventLoopThreadPool : NonCopyable
     }
 
     /**
-     * @brief Get the next event loop in the pool.
+     * @brief Get the next event loop in the pool, picked by the loop selection
+     * policy (round-robin by default).
      *
      * @return EventLoop*
      */
     EventLoop *getNextLoop();
 
+    /**
+     * @brief Get the next event loop in the pool for a connection from peer.
+     * The peer address is used by the PeerHash policy.
+     *
+     * @return EventLoop*
+     */
+    EventLoop *getNextLoop(const InetAddress &peer);
+
+    /**
+     * @brief Set the policy used by getNextLoop().
+     * @note Call it before the pool is used.
+     */
+    void setLoopSelectPolicy(LoopSelectPolicy policy)
+    {
+        loopSelector_.setPolicy(policy);
+    }
+
+    /**
+     * @brief Use a custom function in getNextLoop().
+     * @note Call it before the pool is used.
+     */
+    void setLoopSelectFunc(LoopSelectFunc func)
+    {
+        loopSelector_.setFunc(std::move(func));
+    }
+
     /**
      * @brief Get the event loop in the `id` position in the pool.
      *
@@ -86,8 +115,62 @@ class TRANTOR_EXPORT EventLoopThreadPool : NonCopyable
      */
     std::vector<EventLoop *> getLoops() const;
 
+    /**
+     * @brief Set the budget of queued functions run per loop iteration for
+     * all event loops in the pool.
+     *
+     * @param maxCount The maximum number of functions, 0 means no limit.
+     * @param maxTime The maximum time, 0 means no limit.
+     * @note See EventLoop::setFuncsBudget()
+     */
+    void setFuncsBudget(size_t maxCount,
+                        const std::chrono::microseconds &maxTime =
+                            std::chrono::microseconds(0));
+
+    /**
+     * @brief Enable the busy poll mode for all event loops in the pool.
+     *
+     * @note See EventLoop::setBusyPollTime()
+     */
+    void setBusyPollTime(const std::chrono::microseconds &spinTime,
+                         bool socketBusyPoll = false);
+
+    /**
+     * @brief Set the range of the number of events fetched by one poll for
+     * all event loops in the pool.
+     *
+     * @note See EventLoop::setPollEventsBatchSize()
+     */
+    void setPollEventsBatchSize(size_t minSize, size_t maxSize);
+
+    /**
+     * @brief Pin the threads of the pool to CPUs.
+     *
+     * @param cpus The i-th thread is pinned to cpus[i % cpus.size()]. If cpus
+     * is empty, a NUMA-aware layout is used: the threads are spread over the
+     * NUMA nodes in turn, and inside a node over distinct physical cores
+     * before hyper-threads, using only the CPUs the process may run on.
+     * @return true if all threads are pinned.
+     * @note Only supported on Linux.
+     */
+    bool setCpuAffinity(const std::vector<int> &cpus = {});
+
+    /**
+     * @brief Return the CPU the event loop in the `id` position is pinned to,
+     * or -1 if it is not pinned.
+     */
+    int getLoopCpu(size_t id) const;
+
+    /**
+     * @brief Return the NUMA node of the CPU the event loop in the `id`
+     * position is pinned to, or -1 if it is unknown, e.g. to dispatch
+     * connections to loops on the node of the NIC.
+     */
+    int getLoopNumaNode(size_t id) const;
+
   private:
     std::vector<std::shared_ptr<EventLoopThread>> loopThreadVector_;
-    std::atomic<size_t> loopIndex_{0};
+    std::vector<EventLoop *> loops_;
+    LoopSelector loopSelector_;
 };
 }  // namespace trantor
@@ -0,0 +1,100 @@
+/**
+ *
+ *  LoopSelector.cc
+ *  An Tao
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  https://github.com/an-tao/trantor
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *  Trantor
+ *
+ */
+
+#include <trantor/net/LoopSelector.h>
+#include <assert.h>
+
+using namespace trantor;
+
+namespace
+{
+uint64_t mix(uint64_t x)
+{
+    // splitmix64 finalizer
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t hashIp(const InetAddress &addr)
+{
+    if (!addr.isIpV6())
+        return mix(addr.ipNetEndian());
+    auto ip = addr.ip6NetEndian();
+    uint64_t h = 0;
+    for (int i = 0; i < 4; ++i)
+        h = mix(h ^ ip[i]);
+    return h;
+}
+}  // namespace
+
+EventLoop *LoopSelector::select(const std::vector<EventLoop *> &loops,
+                                const InetAddress *peer)
+{
+    assert(!loops.empty());
+    const size_t n = loops.size();
+    if (n == 1)
+        return loops[0];
+    if (func_)
+        return loops[func_(loops, peer) % n];
+    switch (policy_)
+    {
+        case LoopSelectPolicy::LeastConnections:
+        case LoopSelectPolicy::LeastPendingBytes:
+        {
+            // Start from a rotating index so ties are spread over the loops
+            size_t start = next_.fetch_add(1, std::memory_order_relaxed) % n;
+            size_t best = start;
+            int64_t bestLoad = -1;
+            for (size_t i = 0; i < n; ++i)
+            {
+                size_t idx = (start + i) % n;
+                int64_t load =
+                    policy_ == LoopSelectPolicy::LeastConnections
+                        ? static_cast<int64_t>(loops[idx]->connectionCount())
+                        : loops[idx]->pendingBytes();
+                if (bestLoad < 0 || load < bestLoad)
+                {
+                    best = idx;
+                    bestLoad = load;
+                }
+            }
+            return loops[best];
+        }
+        case LoopSelectPolicy::PeerHash:
+            if (peer)
+            {
+                // Rendezvous hashing, only the peers of a removed loop move
+                // when the number of loops changes
+                uint64_t ipHash = hashIp(*peer);
+                size_t best = 0;
+                uint64_t bestScore = 0;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    uint64_t score = mix(ipHash ^ mix(i));
+                    if (i == 0 || score > bestScore)
+                    {
+                        best = i;
+                        bestScore = score;
+                    }
+                }
+                return loops[best];
+            }
+            break;
+        case LoopSelectPolicy::RoundRobin:
+            break;
+    }
+    return loops[next_.fetch_add(1, std::memory_order_relaxed) % n];
+}
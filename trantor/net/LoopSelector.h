@@ -0,0 +1,101 @@
+/**
+ *
+ *  @file LoopSelector.h
+ *  @author An Tao
+ *
+ *  Public header file in trantor lib.
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *
+ */
+
+#pragma once
+
+#include <trantor/net/EventLoop.h>
+#include <trantor/net/InetAddress.h>
+#include <trantor/utils/NonCopyable.h>
+#include <trantor/exports.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace trantor
+{
+/**
+ * @brief The built-in policies to pick the event loop of a new connection.
+ */
+enum class LoopSelectPolicy
+{
+    RoundRobin,        ///< Loops in turn (the default)
+    LeastConnections,  ///< The loop with the fewest live connections
+    LeastPendingBytes,  ///< The loop with the fewest bytes waiting to be sent
+    PeerHash  ///< Consistent hash of the peer IP, for session affinity
+};
+
+/**
+ * @brief A custom loop selection function. It returns the index of the chosen
+ * loop in loops. peer is nullptr if the caller has no peer address.
+ */
+using LoopSelectFunc =
+    std::function<size_t(const std::vector<EventLoop *> &loops,
+                         const InetAddress *peer)>;
+
+/**
+ * @brief This class picks an event loop out of a group of loops for new
+ * connections, with one of the LoopSelectPolicy policies or a custom
+ * function.
+ */
+class TRANTOR_EXPORT LoopSelector : NonCopyable
+{
+  public:
+    explicit LoopSelector(LoopSelectPolicy policy = LoopSelectPolicy::RoundRobin)
+        : policy_(policy)
+    {
+    }
+
+    /**
+     * @brief Set the policy, this replaces a custom function.
+     * @note Not thread safe, call it before selecting loops.
+     */
+    void setPolicy(LoopSelectPolicy policy)
+    {
+        policy_ = policy;
+        func_ = nullptr;
+    }
+
+    /**
+     * @brief Use a custom selection function.
+     * @note Not thread safe, call it before selecting loops.
+     */
+    void setFunc(LoopSelectFunc func)
+    {
+        func_ = std::move(func);
+    }
+
+    LoopSelectPolicy policy() const
+    {
+        return policy_;
+    }
+
+    /**
+     * @brief Pick a loop.
+     *
+     * @param loops The candidates, must not be empty.
+     * @param peer The peer address of the connection, PeerHash falls back to
+     * round-robin without it.
+     * @return EventLoop*
+     * @note This method is thread safe.
+     */
+    EventLoop *select(const std::vector<EventLoop *> &loops,
+                      const InetAddress *peer = nullptr);
+
+  private:
+    LoopSelectPolicy policy_;
+    LoopSelectFunc func_;
+    std::atomic<size_t> next_{0};
+};
+
+}  // namespace trantor
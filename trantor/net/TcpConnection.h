@@ -25,6 +25,7 @@
 #include <memory>
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace trantor
 {
@@ -59,8 +60,26 @@ class TRANTOR_EXPORT TcpConnection
     virtual void send(std::string &&msg) = 0;
     virtual void send(const MsgBuffer &buffer) = 0;
     virtual void send(MsgBuffer &&buffer) = 0;
+    /**
+     * @brief Send the data in the shared buffer. The buffer is not copied, the
+     * connection holds a reference to it until all the data is sent, so it must
+     * not be modified after this call. This makes it cheap to send the same
+     * message to many connections.
+     */
     virtual void send(const std::shared_ptr<std::string> &msgPtr) = 0;
     virtual void send(const std::shared_ptr<MsgBuffer> &msgPtr) = 0;
+    /**
+     * @brief Send the data of several shared buffers in order, e.g. the header
+     * and the body of a response. The data is written with one writev() call
+     * when the socket is writable, the unsent part is queued as references to
+     * the buffers like above, no data of other send() calls is interleaved.
+     */
+    virtual void send(
+        const std::vector<std::shared_ptr<std::string>> &msgPtrs)
+    {
+        for (auto &msgPtr : msgPtrs)
+            send(msgPtr);
+    }
 
     /**
      * @brief Send a file to the peer.
@@ -159,6 +178,97 @@ class TRANTOR_EXPORT TcpConnection
      */
     virtual void setTcpNoDelay(bool on) = 0;
 
+    /**
+     * @brief Set the priority class of the connection. The I/O events of
+     * higher priority connections are handled first when several connections
+     * of the event loop are ready at the same time, e.g. admin connections can
+     * be made High and bulk downloads Low.
+     *
+     * @param priority
+     */
+    virtual void setPriority(ChannelPriority priority)
+    {
+        (void)priority;
+    }
+
+    /**
+     * @brief Send the data of shared_ptr buffers with MSG_ZEROCOPY when at
+     * least threshold bytes of them are left to send (Linux only). The kernel
+     * sends straight from the buffers, which are referenced until the kernel
+     * reports the completion. It pays off for payloads of hundreds of KB and
+     * more.
+     *
+     * @param threshold The minimum size of the data sent without copying, 0
+     * (the default) disables zero copy sending.
+     */
+    virtual void setZeroCopyThreshold(size_t threshold)
+    {
+        (void)threshold;
+    }
+
+    /**
+     * @brief Enable or disable batch sending. When enabled, the data sent in
+     * the loop thread is not written right away but collected and written at
+     * the end of the current loop iteration (or by flush()), so a handler that
+     * calls send() many times makes fewer and fuller TCP segments, without the
+     * delay of the Nagle algorithm.
+     *
+     * @param on
+     */
+    virtual void setBatchSend(bool on)
+    {
+        (void)on;
+    }
+
+    /**
+     * @brief Write the data collected in batch sending mode now.
+     */
+    virtual void flush()
+    {
+    }
+
+    /**
+     * @brief Size each read from the socket by the amount of received data
+     * reported by the FIONREAD ioctl instead of by the average size of the
+     * previous reads. It helps connections receiving irregular bursts of
+     * data, at the cost of one more system call per read.
+     *
+     * @param on
+     */
+    virtual void setReadSizeQuery(bool on)
+    {
+        (void)on;
+    }
+
+    /**
+     * @brief Set how many bytes may be read from the socket each time it
+     * becomes readable. The connection keeps reading until the socket is
+     * drained or the budget is used up, the message callback is called after
+     * each read. A budget saves a poll round trip per read on fast senders,
+     * while limiting it keeps one connection from holding the loop.
+     *
+     * @param bytes The budget, 0 (the default) means one read each time.
+     */
+    virtual void setReadBudget(size_t bytes)
+    {
+        (void)bytes;
+    }
+
+    /**
+     * @brief Watch the socket in the edge triggered mode (epoll on Linux). The
+     * socket is read until it is drained (or the read budget is used up, the
+     * rest is read later in the same loop iteration) and stays registered for
+     * writability, so a connection writing under backpressure no longer makes
+     * an epoll_ctl() call each time its socket fills up or drains. The mode is
+     * not changed if the poller doesn't support it.
+     *
+     * @param on
+     */
+    virtual void setEdgeTriggered(bool on)
+    {
+        (void)on;
+    }
+
     /**
      * @brief Shutdown the connection.
      * @note This method only closes the writing direction.
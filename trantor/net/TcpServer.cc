@@ -28,14 +28,15 @@ TcpServer::TcpServer(EventLoop *loop,
                      bool reUsePort)
     : loop_(loop),
       acceptorPtr_(new Acceptor(loop, address, reUseAddr, reUsePort)),
+      reUsePort_(reUsePort),
+      maxAcceptsPerEvent_(Acceptor::kDefaultMaxAcceptsPerEvent),
       serverName_(std::move(name)),
       recvMessageCallback_([](const TcpConnectionPtr &, MsgBuffer *buffer) {
           LOG_ERROR << "unhandled recv message [" << buffer->readableBytes()
                     << " bytes]";
           buffer->retrieveAll();
       }),
-      ioLoops_({loop}),
-      numIoLoops_(1)
+      ioLoops_({loop})
 {
     acceptorPtr_->setNewConnectionCallback(
         [this](int fd, const InetAddress &peer) { newConnection(fd, peer); });
@@ -45,28 +46,61 @@ TcpServer::~TcpServer()
 {
     // loop_->assertInLoopThread();
     LOG_TRACE << "TcpServer::~TcpServer [" << serverName_ << "] destructing";
+    removeIoAcceptors();
 }
 
 void TcpServer::setBeforeListenSockOptCallback(SockOptCallback cb)
 {
+    beforeListenSockOptCallback_ = cb;
     acceptorPtr_->setBeforeListenSockOptCallback(std::move(cb));
 }
 
 void TcpServer::setAfterAcceptSockOptCallback(SockOptCallback cb)
 {
+    afterAcceptSockOptCallback_ = cb;
     acceptorPtr_->setAfterAcceptSockOptCallback(std::move(cb));
 }
 
+void TcpServer::setMaxAcceptsPerEvent(size_t num)
+{
+    assert(!started_);
+    maxAcceptsPerEvent_ = num;
+    acceptorPtr_->setMaxAcceptsPerEvent(num);
+}
+
 void TcpServer::newConnection(int sockfd, const InetAddress &peer)
 {
     LOG_TRACE << "new connection:fd=" << sockfd
               << " address=" << peer.toIpPort();
     loop_->assertInLoopThread();
-    EventLoop *ioLoop = ioLoops_[nextLoopIdx_];
-    if (++nextLoopIdx_ >= numIoLoops_)
+    EventLoop *ioLoop = loopSelector_.select(ioLoops_, &peer);
+    auto newPtr = createConnection(ioLoop, sockfd, peer);
+    {
+        std::lock_guard<std::mutex> lock(connSetMutex_);
+        connSet_.insert(newPtr);
+    }
+    newPtr->connectEstablished();
+}
+
+void TcpServer::newConnectionInIoLoop(EventLoop *ioLoop,
+                                      int sockfd,
+                                      const InetAddress &peer)
+{
+    LOG_TRACE << "new connection:fd=" << sockfd
+              << " address=" << peer.toIpPort();
+    ioLoop->assertInLoopThread();
+    auto newPtr = createConnection(ioLoop, sockfd, peer);
     {
-        nextLoopIdx_ = 0;
+        std::lock_guard<std::mutex> lock(connSetMutex_);
+        connSet_.insert(newPtr);
     }
+    newPtr->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop,
+                                             int sockfd,
+                                             const InetAddress &peer)
+{
     TcpConnectionPtr newPtr;
     if (policyPtr_)
     {
@@ -87,8 +121,10 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peer)
 
     if (idleTimeout_ > 0)
     {
-        assert(timingWheelMap_[ioLoop]);
-        newPtr->enableKickingOff(idleTimeout_, timingWheelMap_[ioLoop]);
+        // Not operator[], the I/O loops may read the map concurrently
+        auto iter = timingWheelMap_.find(ioLoop);
+        assert(iter != timingWheelMap_.end() && iter->second);
+        newPtr->enableKickingOff(idleTimeout_, iter->second);
     }
     newPtr->setRecvMsgCallback(recvMessageCallback_);
 
@@ -106,8 +142,94 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peer)
     newPtr->setCloseCallback([this](const TcpConnectionPtr &closeConnPtr) {
         connectionClosed(closeConnPtr);
     });
-    connSet_.insert(newPtr);
-    newPtr->connectEstablished();
+    return newPtr;
+}
+
+void TcpServer::startIoAcceptors()
+{
+    loop_->assertInLoopThread();
+    if (!reUsePort_)
+    {
+        LOG_ERROR << "SO_REUSEPORT acceptors need reUsePort, accepting in "
+                     "the server loop";
+        acceptorPtr_->listen();
+        return;
+    }
+    const auto &addr = acceptorPtr_->addr();
+    for (auto ioLoop : ioLoops_)
+    {
+        std::unique_ptr<Acceptor> acceptor(
+            new Acceptor(ioLoop, addr, true, true));
+        acceptor->setNewConnectionCallback(
+            [this, ioLoop](int fd, const InetAddress &peer) {
+                newConnectionInIoLoop(ioLoop, fd, peer);
+            });
+        acceptor->setBeforeListenSockOptCallback(beforeListenSockOptCallback_);
+        acceptor->setAfterAcceptSockOptCallback(afterAcceptSockOptCallback_);
+        acceptor->setMaxAcceptsPerEvent(maxAcceptsPerEvent_);
+        ioAcceptors_.push_back(std::move(acceptor));
+    }
+    ioAcceptorsToken_ = std::make_shared<int>(0);
+    listenIoAcceptor(0, ioAcceptorsToken_);
+}
+
+void TcpServer::listenIoAcceptor(size_t index, std::weak_ptr<int> token)
+{
+    loop_->assertInLoopThread();
+    // The acceptors were removed meanwhile
+    if (token.expired())
+        return;
+    if (index == ioAcceptors_.size())
+    {
+        if (reusePortCpuFilter_ && !ioAcceptors_.empty())
+            ioAcceptors_.front()->attachReusePortCpuFilter(
+                static_cast<uint32_t>(ioAcceptors_.size()));
+        return;
+    }
+    // The sockets join the SO_REUSEPORT group in the order they listen, so the
+    // next one listens after this one. The index of a socket in the group is
+    // then the index of its loop. Nothing waits here, an I/O loop may not run
+    // yet.
+    auto acceptorPtr = ioAcceptors_[index].get();
+    acceptorPtr->getLoop()->runInLoop(
+        [this, acceptorPtr, index, token = std::move(token)]() {
+            // Removing the acceptor is queued after this in the same loop
+            acceptorPtr->listen();
+            loop_->runInLoop([this, index, token]() {
+                listenIoAcceptor(index + 1, token);
+            });
+        });
+}
+
+void TcpServer::removeIoAcceptors()
+{
+    ioAcceptorsToken_.reset();
+    // Acceptors must be destroyed in their own loops
+    for (auto &acceptor : ioAcceptors_)
+    {
+        auto ioLoop = acceptor->getLoop();
+        if (ioLoop->isInLoopThread())
+        {
+            acceptor.reset();
+        }
+        else if (ioLoop->isRunning())
+        {
+            std::promise<void> pro;
+            auto f = pro.get_future();
+            ioLoop->queueInLoop([&acceptor, &pro]() {
+                acceptor.reset();
+                pro.set_value();
+            });
+            f.get();
+        }
+        else
+        {
+            LOG_ERROR << "The I/O loop of an acceptor quit before the server "
+                         "stopped, leaking its socket";
+            (void)acceptor.release();
+        }
+    }
+    ioAcceptors_.clear();
 }
 
 void TcpServer::start()
@@ -129,21 +251,24 @@ void TcpServer::start()
             }
         }
         LOG_TRACE << "map size=" << timingWheelMap_.size();
-        acceptorPtr_->listen();
+        if (reusePortAcceptors_)
+            startIoAcceptors();
+        else
+            acceptorPtr_->listen();
     });
 }
 void TcpServer::stop()
 {
+    removeIoAcceptors();
     if (loop_->isInLoopThread())
     {
         acceptorPtr_.reset();
         // copy the connSet_ to a vector, use the vector to close the
         // connections to avoid the iterator invalidation.
         std::vector<TcpConnectionPtr> connPtrs;
-        connPtrs.reserve(connSet_.size());
-        for (auto &conn : connSet_)
         {
-            connPtrs.push_back(conn);
+            std::lock_guard<std::mutex> lock(connSetMutex_);
+            connPtrs.assign(connSet_.begin(), connSet_.end());
         }
         for (auto &connection : connPtrs)
         {
@@ -157,10 +282,9 @@ void TcpServer::stop()
         loop_->queueInLoop([this, &pro]() {
             acceptorPtr_.reset();
             std::vector<TcpConnectionPtr> connPtrs;
-            connPtrs.reserve(connSet_.size());
-            for (auto &conn : connSet_)
             {
-                connPtrs.push_back(conn);
+                std::lock_guard<std::mutex> lock(connSetMutex_);
+                connPtrs.assign(connSet_.begin(), connSet_.end());
             }
             for (auto &connection : connPtrs)
             {
@@ -184,7 +308,11 @@ void TcpServer::stop()
 }
 void TcpServer::handleCloseInLoop(const TcpConnectionPtr &connectionPtr)
 {
-    size_t n = connSet_.erase(connectionPtr);
+    size_t n;
+    {
+        std::lock_guard<std::mutex> lock(connSetMutex_);
+        n = connSet_.erase(connectionPtr);
+    }
     (void)n;
     assert(n == 1);
     auto connLoop = connectionPtr->getLoop();
@@ -199,7 +327,8 @@ void TcpServer::handleCloseInLoop(const TcpConnectionPtr &connectionPtr)
 void TcpServer::connectionClosed(const TcpConnectionPtr &connectionPtr)
 {
     LOG_TRACE << "connectionClosed";
-    if (loop_->isInLoopThread())
+    // In the SO_REUSEPORT mode the connection never visits the server loop
+    if (loop_->isInLoopThread() || reusePortAcceptors_)
     {
         handleCloseInLoop(connectionPtr);
     }
@@ -16,6 +16,7 @@
 #include <trantor/exports.h>
 #include <trantor/net/EventLoopThreadPool.h>
 #include <trantor/net/InetAddress.h>
+#include <trantor/net/LoopSelector.h>
 #include <trantor/net/TcpConnection.h>
 #include <trantor/net/callbacks.h>
 #include <trantor/utils/Logger.h>
@@ -23,6 +24,7 @@
 #include <trantor/utils/TimingWheel.h>
 #include <csignal>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 
@@ -78,7 +80,6 @@ class TRANTOR_EXPORT TcpServer : NonCopyable
         loopPoolPtr_ = std::make_shared<EventLoopThreadPool>(num);
         loopPoolPtr_->start();
         ioLoops_ = loopPoolPtr_->getLoops();
-        numIoLoops_ = ioLoops_.size();
     }
 
     /**
@@ -95,7 +96,6 @@ class TRANTOR_EXPORT TcpServer : NonCopyable
         loopPoolPtr_ = pool;
         loopPoolPtr_->start();  // TODO: should not start by TcpServer
         ioLoops_ = loopPoolPtr_->getLoops();
-        numIoLoops_ = ioLoops_.size();
     }
 
     /**
@@ -111,10 +111,59 @@ class TRANTOR_EXPORT TcpServer : NonCopyable
         assert(!ioLoops.empty());
         assert(!started_);
         ioLoops_ = ioLoops;
-        numIoLoops_ = ioLoops_.size();
         loopPoolPtr_.reset();
     }
 
+    /**
+     * @brief Set the policy to pick the I/O loop of a new connection,
+     * round-robin by default.
+     *
+     * @param policy
+     */
+    void setLoopSelectPolicy(LoopSelectPolicy policy)
+    {
+        assert(!started_);
+        loopSelector_.setPolicy(policy);
+    }
+    /**
+     * @brief Use a custom function to pick the I/O loop of a new connection.
+     *
+     * @param func
+     */
+    void setLoopSelectFunc(LoopSelectFunc func)
+    {
+        assert(!started_);
+        loopSelector_.setFunc(std::move(func));
+    }
+    /**
+     * @brief Let every I/O loop accept its own connections on a SO_REUSEPORT
+     * listening socket, instead of accepting all connections in the loop of
+     * the server and handing them to the I/O loops. The kernel spreads the
+     * connections over the sockets and the loop selection policy is not used.
+     *
+     * @param cpuFilter If true, a SO_ATTACH_REUSEPORT_CBPF program hands each
+     * connection to the socket of the I/O loop with index (CPU % number of I/O
+     * loops), Linux only. Pin the I/O loops to the matching CPUs (see
+     * EventLoopThreadPool::setCpuAffinity()) to keep a connection on the CPU
+     * that received it.
+     * @note The server must be constructed with reUsePort = true. start()
+     * doesn't wait for the I/O loops, each socket listens once its loop runs.
+     */
+    void enableReusePortAcceptors(bool cpuFilter = false)
+    {
+        assert(!started_);
+        reusePortAcceptors_ = true;
+        reusePortCpuFilter_ = cpuFilter;
+    }
+    /**
+     * @brief Set the maximum number of connections accepted per read event of
+     * a listening socket, 64 by default. A larger number saves poll round
+     * trips during connection storms, a smaller one keeps the latency of the
+     * other channels of the accepting loop low.
+     *
+     * @param num
+     */
+    void setMaxAcceptsPerEvent(size_t num);
     /**
      * @brief Set the message callback.
      *
@@ -263,11 +312,32 @@ class TRANTOR_EXPORT TcpServer : NonCopyable
   private:
     void handleCloseInLoop(const TcpConnectionPtr &connectionPtr);
     void newConnection(int fd, const InetAddress &peer);
+    void newConnectionInIoLoop(EventLoop *ioLoop,
+                               int fd,
+                               const InetAddress &peer);
+    TcpConnectionPtr createConnection(EventLoop *ioLoop,
+                                      int fd,
+                                      const InetAddress &peer);
+    void startIoAcceptors();
+    void listenIoAcceptor(size_t index, std::weak_ptr<int> token);
+    void removeIoAcceptors();
     void connectionClosed(const TcpConnectionPtr &connectionPtr);
 
     EventLoop *loop_;
     std::unique_ptr<Acceptor> acceptorPtr_;
+    // One acceptor per I/O loop in the SO_REUSEPORT mode
+    std::vector<std::unique_ptr<Acceptor>> ioAcceptors_;
+    // Expires when the acceptors are removed, stops their listen() chain
+    std::shared_ptr<int> ioAcceptorsToken_;
+    bool reUsePort_;
+    bool reusePortAcceptors_{false};
+    bool reusePortCpuFilter_{false};
+    SockOptCallback beforeListenSockOptCallback_;
+    SockOptCallback afterAcceptSockOptCallback_;
+    size_t maxAcceptsPerEvent_;
     std::string serverName_;
+    // Connections are added by the I/O loops in the SO_REUSEPORT mode
+    std::mutex connSetMutex_;
     std::set<TcpConnectionPtr> connSet_;
 
     RecvMessageCallback recvMessageCallback_;
@@ -285,8 +355,7 @@ class TRANTOR_EXPORT TcpServer : NonCopyable
     // called, `ioLoops_` will hold the loops passed in.
     // Otherwise, it should contain only one element, which is `loop_`.
     std::vector<EventLoop *> ioLoops_;
-    size_t nextLoopIdx_{0};
-    size_t numIoLoops_{0};
+    LoopSelector loopSelector_;
 
 #ifndef _WIN32
     class IgnoreSigPipe
@@ -38,6 +38,7 @@ Acceptor::Acceptor(EventLoop *loop,
     sock_.setReusePort(reUsePort);
     sock_.bindAddress(addr_);
     acceptChannel_.setReadCallback(std::bind(&Acceptor::readCallback, this));
+    acceptChannel_.setPriority(ChannelPriority::High);
     if (addr_.toPort() == 0)
     {
         addr_ = InetAddress{Socket::getLocalAddr(sock_.fd())};
@@ -62,34 +63,47 @@ void Acceptor::listen()
 
 void Acceptor::readCallback()
 {
-    InetAddress peer;
-    int newsock = sock_.accept(&peer);
-    if (newsock >= 0)
+    // Drain the backlog, bounded so that a connection storm doesn't starve the
+    // other channels of the loop
+    for (size_t i = 0; i < maxAcceptsPerEvent_; ++i)
     {
-        if (afterAcceptSetSockOptCallback_)
-            afterAcceptSetSockOptCallback_(newsock);
-        if (newConnectionCallback_)
-        {
-            newConnectionCallback_(newsock, peer);
-        }
-        else
+        InetAddress peer;
+        int newsock = sock_.accept(&peer);
+        if (newsock >= 0)
         {
+            if (afterAcceptSetSockOptCallback_)
+                afterAcceptSetSockOptCallback_(newsock);
+            if (newConnectionCallback_)
+            {
+                newConnectionCallback_(newsock, peer);
+            }
+            else
+            {
 #ifndef _WIN32
-            ::close(newsock);
+                ::close(newsock);
 #else
-            closesocket(newsock);
+                closesocket(newsock);
 #endif
+            }
+            continue;
         }
-    }
-    else
-    {
+#ifndef _WIN32
+        int savedErrno = errno;
+        if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)
+            break;
+        if (savedErrno == EINTR || savedErrno == ECONNABORTED)
+            continue;
+#else
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
+            break;
+#endif
         LOG_SYSERR << "Accpetor::readCallback";
 // Read the section named "The special problem of
 // accept()ing when you can't" in libev's doc.
 // By Marc Lehmann, author of libev.
 /// errno is thread safe
 #ifndef _WIN32
-        if (errno == EMFILE)
+        if (savedErrno == EMFILE)
         {
             ::close(idleFd_);
             idleFd_ = sock_.accept(&peer);
@@ -97,5 +111,6 @@ void Acceptor::readCallback()
             idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
         }
 #endif
+        break;
     }
 }
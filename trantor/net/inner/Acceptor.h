@@ -37,12 +37,25 @@ class Acceptor : NonCopyable
     {
         return addr_;
     }
+    EventLoop *getLoop() const
+    {
+        return loop_;
+    }
     void setNewConnectionCallback(const NewConnectionCallback &cb)
     {
         newConnectionCallback_ = cb;
     };
     void listen();
 
+    /**
+     * @brief Steer the connections of the SO_REUSEPORT group of the listening
+     * socket by CPU, see Socket::attachReusePortCpuFilter().
+     */
+    bool attachReusePortCpuFilter(uint32_t groupSize)
+    {
+        return sock_.attachReusePortCpuFilter(groupSize);
+    }
+
     void setBeforeListenSockOptCallback(AcceptorSockOptCallback cb)
     {
         beforeListenSetSockOptCallback_ = std::move(cb);
@@ -53,6 +66,17 @@ class Acceptor : NonCopyable
         afterAcceptSetSockOptCallback_ = std::move(cb);
     }
 
+    /**
+     * @brief Set the maximum number of connections accepted per read event
+     * of the listening socket.
+     */
+    void setMaxAcceptsPerEvent(size_t num)
+    {
+        maxAcceptsPerEvent_ = num > 0 ? num : 1;
+    }
+
+    static constexpr size_t kDefaultMaxAcceptsPerEvent = 64;
+
   protected:
 #ifndef _WIN32
     int idleFd_;
@@ -62,6 +86,7 @@ class Acceptor : NonCopyable
     EventLoop *loop_;
     NewConnectionCallback newConnectionCallback_;
     Channel acceptChannel_;
+    size_t maxAcceptsPerEvent_{kDefaultMaxAcceptsPerEvent};
     void readCallback();
     AcceptorSockOptCallback beforeListenSetSockOptCallback_;
     AcceptorSockOptCallback afterAcceptSetSockOptCallback_;
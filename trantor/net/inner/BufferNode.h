@@ -41,6 +41,15 @@ class BufferNode : public NonCopyable
         return false;
     }
     virtual void getData(const char *&data, size_t &len) = 0;
+    // Get the data in several pieces for nodes which don't keep it in one
+    // piece of memory, return the number of pieces
+    virtual size_t getSegments(const char **data, size_t *len, size_t maxCount)
+    {
+        if (maxCount == 0)
+            return 0;
+        getData(data[0], len[0]);
+        return 1;
+    }
     virtual void append(const char *, size_t)
     {
         LOG_FATAL << "Not a memory buffer node";
@@ -60,12 +69,33 @@ class BufferNode : public NonCopyable
     {
         return false;
     }
+    // True for nodes whose data is in memory and can be gathered with the data
+    // of the next nodes into one writev()
+    virtual bool isMemory() const
+    {
+        return false;
+    }
+    // True for nodes referencing a buffer owned by someone else, no data can be
+    // appended to them
+    virtual bool isShared() const
+    {
+        return false;
+    }
+    // Make the node ready to be handed out again by the pool of the event
+    // loop, return false for the nodes which can't be reused
+    virtual bool resetForReuse()
+    {
+        return false;
+    }
 
     void done()
     {
         isDone_ = true;
     }
     static BufferNodePtr newMemBufferNode();
+    static BufferNodePtr newSharedBufferNode(std::shared_ptr<const void> holder,
+                                             const char *data,
+                                             size_t len);
 
     static BufferNodePtr newStreamBufferNode(StreamCallback &&cb);
 #ifdef _WIN32
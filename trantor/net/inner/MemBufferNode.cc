@@ -1,4 +1,6 @@
 #include <trantor/net/inner/BufferNode.h>
+#include <trantor/net/inner/MemBufferNodePool.h>
+#include <trantor/utils/SegmentedBuffer.h>
 namespace trantor
 {
 class MemBufferNode : public BufferNode
@@ -8,8 +10,13 @@ class MemBufferNode : public BufferNode
 
     void getData(const char *&data, size_t &len) override
     {
-        data = buffer_.peek();
-        len = buffer_.readableBytes();
+        buffer_.peekSegment(data, len);
+    }
+    size_t getSegments(const char **data,
+                       size_t *len,
+                       size_t maxCount) override
+    {
+        return buffer_.getSegments(data, len, maxCount);
     }
     void retrieve(size_t len) override
     {
@@ -24,13 +31,71 @@ class MemBufferNode : public BufferNode
     void append(const char *data, size_t len) override
     {
         buffer_.append(data, len);
+        if (buffer_.readableBytes() > peakBytes_)
+            peakBytes_ = buffer_.readableBytes();
+    }
+    bool isMemory() const override
+    {
+        return true;
+    }
+    // A buffer which has grown is replaced so that pooled nodes don't hold
+    // much memory
+    bool resetForReuse() override
+    {
+        if (peakBytes_ > kBufferDefaultLength)
+        {
+            SegmentedBuffer buffer;
+            buffer_.swap(buffer);
+        }
+        else
+        {
+            buffer_.retrieveAll();
+        }
+        peakBytes_ = 0;
+        isDone_ = false;
+        return true;
     }
 
   private:
-    trantor::MsgBuffer buffer_;
+    // The blocks are linked instead of reallocated when a slow peer leaves a
+    // lot of data in the node
+    trantor::SegmentedBuffer buffer_;
+    size_t peakBytes_{0};
 };
 BufferNodePtr BufferNode::newMemBufferNode()
 {
     return std::make_shared<MemBufferNode>();
 }
+
+BufferNodePtr MemBufferNodePool::get()
+{
+    if (nodes_.empty())
+    {
+        misses_.store(misses_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+        return BufferNode::newMemBufferNode();
+    }
+    hits_.store(hits_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    auto node = std::move(nodes_.back());
+    nodes_.pop_back();
+    size_.store(nodes_.size(), std::memory_order_relaxed);
+    return node;
+}
+
+void MemBufferNodePool::recycle(BufferNodePtr &&node)
+{
+    auto capacity = capacity_.load(std::memory_order_relaxed);
+    if (nodes_.size() > capacity)
+    {
+        // The capacity was lowered
+        nodes_.resize(capacity);
+        size_.store(nodes_.size(), std::memory_order_relaxed);
+    }
+    if (nodes_.size() == capacity || node.use_count() != 1 ||
+        !node->resetForReuse())
+        return;
+    nodes_.push_back(std::move(node));
+    size_.store(nodes_.size(), std::memory_order_relaxed);
+}
 }  // namespace trantor
@@ -0,0 +1,72 @@
+/**
+ *
+ *  @file MemBufferNodePool.h
+ *  @author An Tao
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  https://github.com/an-tao/trantor
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *  Trantor
+ *
+ */
+
+#pragma once
+#include <trantor/net/inner/BufferNode.h>
+#include <trantor/utils/NonCopyable.h>
+#include <atomic>
+#include <vector>
+
+namespace trantor
+{
+/**
+ * @brief The free list of memory buffer nodes of an event loop. The nodes
+ * flushed by the connections of the loop are kept with their buffers and
+ * handed out again instead of allocating new ones.
+ * @note get() and recycle() are only called in the loop thread, the
+ * capacity and the statistics can be accessed in any thread.
+ */
+class MemBufferNodePool : public NonCopyable
+{
+  public:
+    static constexpr size_t kDefaultCapacity = 1024;
+
+    BufferNodePtr get();
+    /**
+     * @brief Give back a node which is no longer used, nodes of other types,
+     * still referenced elsewhere or beyond the capacity are just released.
+     */
+    void recycle(BufferNodePtr &&node);
+
+    void setCapacity(size_t capacity)
+    {
+        capacity_.store(capacity, std::memory_order_relaxed);
+    }
+    size_t capacity() const
+    {
+        return capacity_.load(std::memory_order_relaxed);
+    }
+    size_t size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+    uint64_t hits() const
+    {
+        return hits_.load(std::memory_order_relaxed);
+    }
+    uint64_t misses() const
+    {
+        return misses_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::vector<BufferNodePtr> nodes_;
+    std::atomic<size_t> capacity_{kDefaultCapacity};
+    // Only written by the loop thread
+    std::atomic<size_t> size_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+}  // namespace trantor
@@ -15,6 +15,8 @@
 #include "Poller.h"
 #ifdef __linux__
 #include "poller/EpollPoller.h"
+#include "poller/IoUringPoller.h"
+#include <trantor/utils/Logger.h>
 #elif defined _WIN32
 #include "Wepoll.h"
 #include "poller/EpollPoller.h"
@@ -24,8 +26,67 @@
 #include "poller/PollPoller.h"
 #endif
 using namespace trantor;
-Poller *Poller::newPoller(EventLoop *loop)
+
+namespace
+{
+// The event array is halved after this number of consecutive polls returning
+// less than a quarter of its size. The polls returning no events (timeouts
+// and busy polling) tell nothing about the load, they are not counted.
+const size_t kShrinkAfterPolls = 256;
+}  // namespace
+
+size_t Poller::nextEventBatchSize(size_t size, size_t numEvents)
 {
+    if (spinning_)
+    {
+        // A busy polling loop may only ever get its events from the spin
+        // polls, so a full array still grows, but nothing is counted
+        if (numEvents >= size && size < maxEventBatchSize_)
+            return size * 2 > maxEventBatchSize_ ? maxEventBatchSize_
+                                                 : size * 2;
+        return size;
+    }
+    if (numEvents >= size)
+    {
+        sparsePolls_ = 0;
+        if (size >= maxEventBatchSize_)
+        {
+            saturatedPolls_.store(
+                saturatedPolls_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        }
+        size *= 2;
+    }
+    else if (numEvents >= size / 4)
+    {
+        sparsePolls_ = 0;
+    }
+    else if (numEvents > 0 && ++sparsePolls_ >= kShrinkAfterPolls)
+    {
+        sparsePolls_ = 0;
+        size /= 2;
+    }
+    if (size < minEventBatchSize_)
+        return minEventBatchSize_;
+    if (size > maxEventBatchSize_)
+        return maxEventBatchSize_;
+    return size;
+}
+
+Poller *Poller::newPoller(EventLoop *loop, PollerBackend backend)
+{
+#ifdef __linux__
+    if (backend == PollerBackend::IoUring)
+    {
+        auto poller = new IoUringPoller(loop);
+        if (poller->valid())
+            return poller;
+        delete poller;
+        LOG_WARN << "io_uring is not available, using epoll";
+    }
+#else
+    (void)backend;
+#endif
 #if defined __linux__ || defined _WIN32
     return new EpollPoller(loop);
 #elif defined __FreeBSD__ || defined __OpenBSD__ || defined __APPLE__
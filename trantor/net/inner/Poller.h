@@ -16,6 +16,7 @@
 #include "NonCopyable.h"
 #include "EventLoop.h"
 
+#include <atomic>
 #include <memory>
 #include <map>
 
@@ -37,6 +38,15 @@ class Poller : NonCopyable
         ownerLoop_->assertInLoopThread();
     }
     virtual void poll(int timeoutMs, ChannelList *activeChannels) = 0;
+    // Polls without waiting for the busy poll mode of the event loop, which
+    // counts these polls itself. They are left out of the histogram and the
+    // counters of the event batch size.
+    void spinPoll(ChannelList *activeChannels)
+    {
+        spinning_ = true;
+        poll(0, activeChannels);
+        spinning_ = false;
+    }
     virtual void updateChannel(Channel *channel) = 0;
     virtual void removeChannel(Channel *channel) = 0;
 #ifdef _WIN32
@@ -46,9 +56,88 @@ class Poller : NonCopyable
     virtual void resetAfterFork()
     {
     }
-    static Poller *newPoller(EventLoop *loop);
+    virtual PollerBackend backend() const
+    {
+        return PollerBackend::Default;
+    }
+    // True if channels can be watched in the edge triggered mode
+    virtual bool supportsEdgeTriggered() const
+    {
+        return false;
+    }
+    // The number of system calls made to change the watched events
+    uint64_t interestUpdates() const
+    {
+        return interestUpdates_.load(std::memory_order_relaxed);
+    }
+    // Sets the range of the number of events fetched by one poll, for the
+    // pollers fetching the events into an array
+    void setEventBatchSize(size_t minSize, size_t maxSize)
+    {
+        assertInLoopThread();
+        minEventBatchSize_ = minSize > 0 ? minSize : 1;
+        maxEventBatchSize_ =
+            maxSize > minEventBatchSize_ ? maxSize : minEventBatchSize_;
+    }
+    // The number of polls which filled the event array at its maximum size
+    uint64_t saturatedPolls() const
+    {
+        return saturatedPolls_.load(std::memory_order_relaxed);
+    }
+    PollEventsHistogram pollEventsHistogram() const
+    {
+        PollEventsHistogram histogram;
+        for (size_t i = 0; i < kPollEventsBuckets; ++i)
+        {
+            histogram[i] = pollEvents_[i].load(std::memory_order_relaxed);
+        }
+        return histogram;
+    }
+    static Poller *newPoller(EventLoop *loop, PollerBackend backend);
+
+  protected:
+    // Returns the size of the event array for the next poll, given the size
+    // used by the last one and the number of events it returned
+    size_t nextEventBatchSize(size_t size, size_t numEvents);
+    // Counts the events returned by one poll in the histogram
+    void recordPollEvents(size_t numEvents)
+    {
+        if (spinning_)
+            return;
+        size_t bucket = 0;
+        while (numEvents > 0 && bucket < kPollEventsBuckets - 1)
+        {
+            numEvents >>= 1;
+            ++bucket;
+        }
+        // Only written by the loop thread
+        pollEvents_[bucket].store(
+            pollEvents_[bucket].load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    }
+    size_t minEventBatchSize() const
+    {
+        return minEventBatchSize_;
+    }
+
+    void countInterestUpdate()
+    {
+        // Only written by the loop thread
+        interestUpdates_.store(
+            interestUpdates_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    }
 
   private:
     EventLoop *ownerLoop_;
+    std::atomic<uint64_t> interestUpdates_{0};
+    std::atomic<uint64_t> saturatedPolls_{0};
+    std::atomic<uint64_t> pollEvents_[kPollEventsBuckets]{};
+    size_t minEventBatchSize_{16};
+    size_t maxEventBatchSize_{4096};
+    // The number of consecutive polls returning few events
+    size_t sparsePolls_{0};
+    // Set during the polls made by spinPoll()
+    bool spinning_{false};
 };
 }  // namespace trantor
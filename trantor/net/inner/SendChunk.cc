@@ -0,0 +1,144 @@
+/**
+ *
+ *  @file SendChunk.cc
+ *  @author An Tao
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  https://github.com/an-tao/trantor
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *  Trantor
+ *
+ */
+
+#include "SendChunk.h"
+#include <mutex>
+#include <string.h>
+
+using namespace trantor;
+
+namespace
+{
+// Chunks move between the thread caches and the depot in batches, both are
+// fixed arrays so moving a batch doesn't allocate
+constexpr size_t kBatchSize = 32;
+constexpr size_t kMaxCachedChunks = 2 * kBatchSize;
+constexpr size_t kMaxDepotBatches = 64;
+
+struct ChunkDepot
+{
+    std::mutex mutex_;
+    char *batches_[kMaxDepotBatches][kBatchSize];
+    size_t count_{0};
+    ~ChunkDepot()
+    {
+        for (size_t i = 0; i < count_; ++i)
+            for (auto chunk : batches_[i])
+                delete[] chunk;
+    }
+};
+ChunkDepot &depot()
+{
+    static ChunkDepot depot;
+    return depot;
+}
+
+struct ChunkCache
+{
+    char *chunks_[kMaxCachedChunks];
+    size_t count_{0};
+    ~ChunkCache();
+};
+// Set when the cache of the thread is gone, e.g. a chunk released by a
+// thread_local object destroyed after it
+thread_local bool cacheDestroyed{false};
+thread_local ChunkCache cache;
+ChunkCache::~ChunkCache()
+{
+    cacheDestroyed = true;
+    for (size_t i = 0; i < count_; ++i)
+        delete[] chunks_[i];
+}
+
+char *allocChunk()
+{
+    if (cacheDestroyed)
+        return new char[SendChunk::kChunkSize];
+    if (cache.count_ == 0)
+    {
+        auto &d = depot();
+        std::lock_guard<std::mutex> lock(d.mutex_);
+        if (d.count_ > 0)
+        {
+            --d.count_;
+            memcpy(cache.chunks_,
+                   d.batches_[d.count_],
+                   sizeof(char *) * kBatchSize);
+            cache.count_ = kBatchSize;
+        }
+    }
+    if (cache.count_ == 0)
+        return new char[SendChunk::kChunkSize];
+    return cache.chunks_[--cache.count_];
+}
+
+void freeChunk(char *chunk)
+{
+    if (cacheDestroyed)
+    {
+        delete[] chunk;
+        return;
+    }
+    cache.chunks_[cache.count_++] = chunk;
+    if (cache.count_ < kMaxCachedChunks)
+        return;
+    // Chunks are usually taken in the threads calling send() and freed in
+    // the loop threads, hand a batch over to the depot.
+    cache.count_ -= kBatchSize;
+    char **batch = cache.chunks_ + cache.count_;
+    auto &d = depot();
+    {
+        std::lock_guard<std::mutex> lock(d.mutex_);
+        if (d.count_ < kMaxDepotBatches)
+        {
+            memcpy(d.batches_[d.count_], batch, sizeof(char *) * kBatchSize);
+            ++d.count_;
+            return;
+        }
+    }
+    for (size_t i = 0; i < kBatchSize; ++i)
+        delete[] batch[i];
+}
+}  // namespace
+
+SendChunk::SendChunk(const char *data, size_t len)
+    : data_(len <= kChunkSize ? allocChunk() : new char[len]), len_(len)
+{
+    if (len > 0)
+        memcpy(data_, data, len);
+}
+
+SendChunk &SendChunk::operator=(SendChunk &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        data_ = other.data_;
+        len_ = other.len_;
+        other.data_ = nullptr;
+        other.len_ = 0;
+    }
+    return *this;
+}
+
+void SendChunk::release() noexcept
+{
+    if (!data_)
+        return;
+    if (len_ <= kChunkSize)
+        freeChunk(data_);
+    else
+        delete[] data_;
+    data_ = nullptr;
+}
@@ -0,0 +1,61 @@
+/**
+ *
+ *  @file SendChunk.h
+ *  @author An Tao
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  https://github.com/an-tao/trantor
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *  Trantor
+ *
+ */
+
+#pragma once
+#include <cstddef>
+
+namespace trantor
+{
+/**
+ * @brief A copy of the data passed to TcpConnection::send() in a thread other
+ * than the loop thread. Data up to kChunkSize bytes is copied into a chunk
+ * from a pool, which is cached per thread and refilled in batches from a
+ * shared depot, so handing data over to the loop thread doesn't call malloc
+ * in the steady state.
+ */
+class SendChunk
+{
+  public:
+    static constexpr size_t kChunkSize = 4096;
+
+    SendChunk(const char *data, size_t len);
+    SendChunk(SendChunk &&other) noexcept : data_(other.data_), len_(other.len_)
+    {
+        other.data_ = nullptr;
+        other.len_ = 0;
+    }
+    SendChunk &operator=(SendChunk &&other) noexcept;
+    SendChunk(const SendChunk &) = delete;
+    SendChunk &operator=(const SendChunk &) = delete;
+    ~SendChunk()
+    {
+        release();
+    }
+
+    const char *data() const
+    {
+        return data_;
+    }
+    size_t size() const
+    {
+        return len_;
+    }
+
+  private:
+    void release() noexcept;
+    char *data_;
+    size_t len_;
+};
+
+}  // namespace trantor
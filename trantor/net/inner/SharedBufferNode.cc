@@ -0,0 +1,55 @@
+#include <trantor/net/inner/BufferNode.h>
+#include <cassert>
+namespace trantor
+{
+// A node that sends directly from a buffer shared with the caller (e.g. the
+// payload of send(std::shared_ptr<std::string>)), the holder keeps the buffer
+// alive until all the data is sent.
+class SharedBufferNode : public BufferNode
+{
+  public:
+    SharedBufferNode(std::shared_ptr<const void> holder,
+                     const char *data,
+                     size_t len)
+        : holder_(std::move(holder)), data_(data), length_(len)
+    {
+    }
+
+    void getData(const char *&data, size_t &len) override
+    {
+        data = data_ + offset_;
+        len = length_ - offset_;
+    }
+    void retrieve(size_t len) override
+    {
+        assert(len <= length_ - offset_);
+        offset_ += len;
+    }
+    long long remainingBytes() const override
+    {
+        if (isDone_)
+            return 0;
+        return static_cast<long long>(length_ - offset_);
+    }
+    bool isMemory() const override
+    {
+        return true;
+    }
+    bool isShared() const override
+    {
+        return true;
+    }
+
+  private:
+    std::shared_ptr<const void> holder_;
+    const char *data_;
+    size_t length_;
+    size_t offset_{0};
+};
+BufferNodePtr BufferNode::newSharedBufferNode(std::shared_ptr<const void> holder,
+                                              const char *data,
+                                              size_t len)
+{
+    return std::make_shared<SharedBufferNode>(std::move(holder), data, len);
+}
+}  // namespace trantor
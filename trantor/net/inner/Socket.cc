@@ -21,6 +21,9 @@
 #else
 #include <sys/socket.h>
 #include <netinet/tcp.h>
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
 #endif
 
 using namespace trantor;
@@ -83,7 +86,8 @@ int Socket::accept(InetAddress *peeraddr)
     struct sockaddr_in6 addr6;
     memset(&addr6, 0, sizeof(addr6));
     socklen_t size = sizeof(addr6);
-#ifdef __linux__
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__)
     int connfd = ::accept4(sockFd_,
                            (struct sockaddr *)&addr6,
                            &size,
@@ -217,6 +221,78 @@ void Socket::setKeepAlive(bool on)
     // TODO CHECK
 }
 
+void Socket::setBusyPoll(int usec)
+{
+#ifdef SO_BUSY_POLL
+    int ret = ::setsockopt(sockFd_,
+                           SOL_SOCKET,
+                           SO_BUSY_POLL,
+                           &usec,
+                           static_cast<socklen_t>(sizeof usec));
+    if (ret < 0)
+    {
+        LOG_SYSERR << "SO_BUSY_POLL failed.";
+    }
+#else
+    (void)usec;
+    LOG_ERROR << "SO_BUSY_POLL is not supported.";
+#endif
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+    int optval = on ? 1 : 0;
+    int ret = ::setsockopt(sockFd_,
+                           SOL_SOCKET,
+                           SO_ZEROCOPY,
+                           &optval,
+                           static_cast<socklen_t>(sizeof optval));
+    if (ret < 0)
+    {
+        LOG_SYSERR << "SO_ZEROCOPY failed.";
+        return false;
+    }
+    return true;
+#else
+    (void)on;
+    LOG_ERROR << "SO_ZEROCOPY is not supported.";
+    return false;
+#endif
+}
+
+bool Socket::attachReusePortCpuFilter(uint32_t groupSize)
+{
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    struct sock_filter code[] = {
+        // A = raw_smp_processor_id()
+        {BPF_LD | BPF_W | BPF_ABS,
+         0,
+         0,
+         static_cast<__u32>(SKF_AD_OFF + SKF_AD_CPU)},
+        // A = A % groupSize
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, groupSize},
+        // return A
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    struct sock_fprog prog;
+    prog.len = static_cast<unsigned short>(sizeof(code) / sizeof(code[0]));
+    prog.filter = code;
+    if (::setsockopt(
+            sockFd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) <
+        0)
+    {
+        LOG_SYSERR << "SO_ATTACH_REUSEPORT_CBPF failed.";
+        return false;
+    }
+    return true;
+#else
+    (void)groupSize;
+    LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF is not supported.";
+    return false;
+#endif
+}
+
 int Socket::getSocketError()
 {
 #ifdef _WIN32
@@ -119,6 +119,26 @@ class Socket : NonCopyable
     /// Enable/disable SO_KEEPALIVE
     ///
     void setKeepAlive(bool on);
+
+    ///
+    /// Set SO_BUSY_POLL, the time in microseconds to busy poll the device
+    /// queue on blocking receives (Linux only)
+    ///
+    void setBusyPoll(int usec);
+
+    ///
+    /// Enable SO_ZEROCOPY so that send(MSG_ZEROCOPY) can be used on the
+    /// socket (Linux only), return false if it's not supported
+    ///
+    bool setZeroCopy(bool on);
+
+    ///
+    /// Attach a SO_ATTACH_REUSEPORT_CBPF program to the SO_REUSEPORT group of
+    /// the socket, which hands a connection to the listening socket at
+    /// index (CPU of the receiving softirq % groupSize) in the order they
+    /// started to listen (Linux only)
+    ///
+    bool attachReusePortCpuFilter(uint32_t groupSize);
     int getSocketError();
 
   protected:
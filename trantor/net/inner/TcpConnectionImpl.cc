@@ -15,14 +15,23 @@
 #include "TcpConnectionImpl.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "SendChunk.h"
+#include "MemBufferNodePool.h"
 #include <trantor/utils/Utilities.h>
 #ifdef __linux__
 #include <sys/sendfile.h>
 #include <poll.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
 #endif
 #include <sys/types.h>
 #ifndef _WIN32
 #include <unistd.h>
+#include <sys/uio.h>
+#include <limits.h>
 #endif
 
 using namespace trantor;
@@ -78,10 +87,19 @@ TcpConnectionImpl::TcpConnectionImpl(EventLoop *loop,
     LOG_TRACE << "new connection:" << peerAddr.toIpPort() << "->"
               << localAddr.toIpPort();
     ioChannelPtr_->setReadCallback([this]() { readCallback(); });
-    ioChannelPtr_->setWriteCallback([this]() { writeCallback(); });
+    ioChannelPtr_->setWriteCallback([this]() {
+        writeCallback();
+        updatePendingBytes();
+    });
     ioChannelPtr_->setCloseCallback([this]() { handleClose(); });
     ioChannelPtr_->setErrorCallback([this]() { handleError(); });
     socketPtr_->setKeepAlive(true);
+    // Counted here rather than when established, so a burst of accepted
+    // connections is already visible to the loop selection
+    loop_->updateConnectionStats(1, 0);
+    if (loop->socketBusyPoll())
+        socketPtr_->setBusyPoll(
+            static_cast<int>(loop->busyPollTime().count()));
     name_ = localAddr.toIpPort() + "--" + peerAddr.toIpPort();
 
     if (policy != nullptr)
@@ -123,56 +141,61 @@ TcpConnectionImpl::~TcpConnectionImpl()
     // send a close alert to peer if we are still connected
     if (tlsProviderPtr_ && status_ == ConnStatus::Connected)
         tlsProviderPtr_->close();
+    releaseConnectionStats();
 }
 
 void TcpConnectionImpl::readCallback()
 {
     // LOG_TRACE<<"read Callback";
     loop_->assertInLoopThread();
-    int ret = 0;
-
-    ssize_t n = readBuffer_.readFd(socketPtr_->fd(), &ret);
-    // LOG_TRACE<<"read "<<n<<" bytes from socket";
-    if (n == 0)
+    const bool edgeTriggered = ioChannelPtr_->isEdgeTriggered();
+    size_t totalRead = 0;
+    while (true)
     {
-        // socket closed by peer
-        handleClose();
-    }
-    else if (n < 0)
-    {
-        if (errno == EPIPE || errno == ECONNRESET)
+        int ret = 0;
+        size_t room = readBuffer_.writableBytes();
+        ssize_t n =
+            readBuffer_.readFd(socketPtr_->fd(), &ret, readSizeQuery_);
+        // LOG_TRACE<<"read "<<n<<" bytes from socket";
+        if (n == 0)
         {
+            // socket closed by peer
+            handleClose();
+            return;
+        }
+        else if (n < 0)
+        {
+            if (errno == EPIPE || errno == ECONNRESET)
+            {
 #ifdef _WIN32
-            LOG_TRACE << "WSAENOTCONN or WSAECONNRESET, errno=" << errno
-                      << " fd=" << socketPtr_->fd();
+                LOG_TRACE << "WSAENOTCONN or WSAECONNRESET, errno=" << errno
+                          << " fd=" << socketPtr_->fd();
 #else
-            LOG_TRACE << "EPIPE or ECONNRESET, errno=" << errno
-                      << " fd=" << socketPtr_->fd();
+                LOG_TRACE << "EPIPE or ECONNRESET, errno=" << errno
+                          << " fd=" << socketPtr_->fd();
 #endif
-            return;
-        }
+                return;
+            }
 #ifdef _WIN32
-        if (errno == WSAECONNABORTED)
-        {
-            LOG_TRACE << "WSAECONNABORTED, errno=" << errno;
+            if (errno == WSAECONNABORTED)
+            {
+                LOG_TRACE << "WSAECONNABORTED, errno=" << errno;
+                handleClose();
+                return;
+            }
+#endif
+            // The socket may be drained by the previous read of this loop
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                LOG_TRACE << "EAGAIN, errno=" << errno
+                          << " fd=" << socketPtr_->fd();
+                return;
+            }
+            LOG_SYSERR << "read socket error";
             handleClose();
             return;
         }
-#else
-        if (errno == EAGAIN)  // TODO: any others?
-        {
-            LOG_TRACE << "EAGAIN, errno=" << errno
-                      << " fd=" << socketPtr_->fd();
-            return;
-        }
-#endif
-        LOG_SYSERR << "read socket error";
-        handleClose();
-        return;
-    }
-    extendLife();
-    if (n > 0)
-    {
+        extendLife();
         bytesReceived_ += n;
         if (tlsProviderPtr_)
         {
@@ -182,6 +205,32 @@ void TcpConnectionImpl::readCallback()
         {
             recvMsgCallback_(shared_from_this(), &readBuffer_);
         }
+        // Keep reading while the socket has more data, up to the budget, so
+        // one busy connection doesn't hold the loop. A read that didn't fill
+        // the free space has drained the socket.
+        totalRead += static_cast<size_t>(n);
+        if (status_ == ConnStatus::Disconnected)
+            break;
+        if (edgeTriggered)
+        {
+            // No new event comes for the data left in the socket, read it
+            // after the other channels have been handled
+            if (readBudget_ > 0 && totalRead >= readBudget_)
+            {
+                loop_->queueInLoop(
+                    [weakPtr = std::weak_ptr<TcpConnectionImpl>(
+                         shared_from_this())]() {
+                        auto thisPtr = weakPtr.lock();
+                        if (thisPtr &&
+                            thisPtr->status_ != ConnStatus::Disconnected)
+                            thisPtr->readCallback();
+                    });
+                break;
+            }
+            continue;
+        }
+        if (totalRead >= readBudget_ || static_cast<size_t>(n) < room)
+            break;
     }
 }
 void TcpConnectionImpl::extendLife()
@@ -206,54 +255,143 @@ void TcpConnectionImpl::writeCallback()
     loop_->assertInLoopThread();
     if (ioChannelPtr_->isWriting())
     {
-        if (tlsProviderPtr_)
+        sendBufferedInLoop();
+    }
+    else
+    {
+        LOG_SYSERR << "no writing but write callback called";
+    }
+}
+void TcpConnectionImpl::sendBufferedInLoop()
+{
+    if (tlsProviderPtr_)
+    {
+        bool sentAll = tlsProviderPtr_->sendBufferedData();
+        if (!sentAll)
         {
-            bool sentAll = tlsProviderPtr_->sendBufferedData();
-            if (!sentAll)
-            {
-                return;
-            }
+            return;
         }
-        while (!writeBufferList_.empty())
+    }
+    while (!writeBufferList_.empty())
+    {
+        auto &nodePtr = writeBufferList_.front();
+        if (nodePtr->remainingBytes() == 0)
         {
-            auto &nodePtr = writeBufferList_.front();
-            if (nodePtr->remainingBytes() == 0)
+            if (!nodePtr->isAsync() || !nodePtr->available())
             {
-                if (!nodePtr->isAsync() || !nodePtr->available())
-                {
-                    // finished sending
-                    writeBufferList_.pop_front();
-                }
-                else
-                {
-                    // the first node is an async node and is available
-                    ioChannelPtr_->disableWriting();
-                    return;
-                }
+                // finished sending
+                popWriteBufferNode();
             }
             else
             {
-                // continue sending
-                auto n = sendNodeInLoop(nodePtr);
-                if (nodePtr->remainingBytes() > 0 || n < 0)
-                    return;
+                // the first node is an async node and is available
+                if (ioChannelPtr_->isWriting())
+                    ioChannelPtr_->disableWriting();
+                return;
             }
         }
-        assert(writeBufferList_.empty());
-        if (tlsProviderPtr_ == nullptr ||
-            tlsProviderPtr_->getBufferedData().readableBytes() == 0)
+#ifndef _WIN32
+        else if (!tlsProviderPtr_ && nodePtr->isMemory() &&
+                 !useZeroCopy(nodePtr))
+        {
+            // flush consecutive memory nodes (and the blocks of them) with
+            // one syscall
+            bool sentAll;
+            auto n = writevNodesInLoop(sentAll);
+            if (n < 0 || !sentAll)
+                return;
+        }
+#endif
+        else
         {
+            // continue sending
+            auto before = nodePtr->remainingBytes();
+            auto n = sendNodeInLoop(nodePtr);
+            queuedBytes_ += nodePtr->remainingBytes() - before;
+            if (nodePtr->remainingBytes() > 0 || n < 0)
+                return;
+        }
+    }
+    assert(writeBufferList_.empty());
+    if (tlsProviderPtr_ == nullptr ||
+        tlsProviderPtr_->getBufferedData().readableBytes() == 0)
+    {
+        if (ioChannelPtr_->isWriting())
             ioChannelPtr_->disableWriting();
-            if (closeOnEmpty_)
-            {
-                shutdown();
-            }
+        if (closeOnEmpty_)
+        {
+            shutdown();
         }
     }
-    else
+}
+void TcpConnectionImpl::popWriteBufferNode()
+{
+    auto node = std::move(writeBufferList_.front());
+    writeBufferList_.pop_front();
+    queuedBytes_ -= node->remainingBytes();
+    loop_->bufferNodePool().recycle(std::move(node));
+}
+bool TcpConnectionImpl::writeDirectly()
+{
+    if (ioChannelPtr_->isWriting() || !writeBufferList_.empty())
+        return false;
+    if (!batchSend_)
+        return true;
+    if (!flushScheduled_)
     {
-        LOG_SYSERR << "no writing but write callback called";
+        flushScheduled_ = true;
+        loop_->runAfterDispatch(
+            [weakPtr = std::weak_ptr<TcpConnectionImpl>(shared_from_this())]() {
+                auto thisPtr = weakPtr.lock();
+                if (thisPtr)
+                    thisPtr->flushInLoop();
+            });
     }
+    return false;
+}
+void TcpConnectionImpl::flushInLoop()
+{
+    loop_->assertInLoopThread();
+    flushScheduled_ = false;
+    // Otherwise the data is sent when the socket becomes writable
+    if (status_ == ConnStatus::Connected && !ioChannelPtr_->isWriting())
+        sendBufferedInLoop();
+}
+void TcpConnectionImpl::flush()
+{
+    auto thisPtr = shared_from_this();
+    loop_->runInLoop([thisPtr]() { thisPtr->flushInLoop(); });
+}
+void TcpConnectionImpl::setBatchSend(bool on)
+{
+    auto thisPtr = shared_from_this();
+    loop_->runInLoop([thisPtr, on]() {
+        thisPtr->batchSend_ = on;
+        if (!on)
+            thisPtr->flushInLoop();
+    });
+}
+void TcpConnectionImpl::setReadSizeQuery(bool on)
+{
+    auto thisPtr = shared_from_this();
+    loop_->runInLoop([thisPtr, on]() { thisPtr->readSizeQuery_ = on; });
+}
+void TcpConnectionImpl::setReadBudget(size_t bytes)
+{
+    auto thisPtr = shared_from_this();
+    loop_->runInLoop([thisPtr, bytes]() { thisPtr->readBudget_ = bytes; });
+}
+void TcpConnectionImpl::setEdgeTriggered(bool on)
+{
+    auto thisPtr = shared_from_this();
+    loop_->runInLoop([thisPtr, on]() {
+        if (on && !thisPtr->loop_->supportsEdgeTriggered())
+        {
+            LOG_WARN << "The poller doesn't support the edge triggered mode";
+            return;
+        }
+        thisPtr->ioChannelPtr_->setEdgeTriggered(on);
+    });
 }
 void TcpConnectionImpl::connectEstablished()
 {
@@ -295,6 +433,11 @@ void TcpConnectionImpl::handleClose()
 }
 void TcpConnectionImpl::handleError()
 {
+#ifdef __linux__
+    // MSG_ZEROCOPY completions are reported through the error queue
+    if (zeroCopyEnabled_)
+        handleZeroCopyCompletions();
+#endif
     int err = socketPtr_->getSocketError();
     if (err == 0)
         return;
@@ -317,6 +460,30 @@ void TcpConnectionImpl::setTcpNoDelay(bool on)
 {
     socketPtr_->setTcpNoDelay(on);
 }
+void TcpConnectionImpl::setPriority(ChannelPriority priority)
+{
+    auto thisPtr = shared_from_this();
+    loop_->runInLoop([thisPtr, priority]() {
+        thisPtr->ioChannelPtr_->setPriority(priority);
+    });
+}
+void TcpConnectionImpl::setZeroCopyThreshold(size_t threshold)
+{
+    auto thisPtr = shared_from_this();
+    loop_->runInLoop([thisPtr, threshold]() {
+        if (threshold > 0 && !thisPtr->zeroCopyEnabled_)
+        {
+#ifdef __linux__
+            thisPtr->zeroCopyEnabled_ = thisPtr->socketPtr_->setZeroCopy(true);
+#else
+            LOG_ERROR << "Zero copy sending is not supported";
+#endif
+            if (!thisPtr->zeroCopyEnabled_)
+                return;
+        }
+        thisPtr->zeroCopyThreshold_ = threshold;
+    });
+}
 void TcpConnectionImpl::connectDestroyed()
 {
     loop_->assertInLoopThread();
@@ -328,6 +495,34 @@ void TcpConnectionImpl::connectDestroyed()
         connectionCallback_(shared_from_this());
     }
     ioChannelPtr_->remove();
+#ifdef __linux__
+    // The buffers must outlive the fd of the connection
+    lingerZeroCopySends();
+#endif
+    releaseConnectionStats();
+}
+void TcpConnectionImpl::updatePendingBytes()
+{
+    if (!countedInLoop_)
+        return;
+    long long pending = queuedBytes_;
+    if (tlsProviderPtr_)
+        pending += static_cast<long long>(
+            tlsProviderPtr_->getBufferedData().readableBytes());
+    if (pending != pendingBytes_)
+    {
+        loop_->updateConnectionStats(0, pending - pendingBytes_);
+        pendingBytes_ = pending;
+    }
+}
+void TcpConnectionImpl::releaseConnectionStats()
+{
+    if (countedInLoop_)
+    {
+        loop_->updateConnectionStats(-1, -pendingBytes_);
+        pendingBytes_ = 0;
+        countedInLoop_ = false;
+    }
 }
 void TcpConnectionImpl::shutdown()
 {
@@ -348,8 +543,11 @@ void TcpConnectionImpl::shutdown()
                 }
                 thisPtr->tlsProviderPtr_->close();
             }
+            // Also wait for the kernel to release the buffers of the
+            // MSG_ZEROCOPY sends
             if (thisPtr->tlsProviderPtr_ == nullptr &&
-                !thisPtr->writeBufferList_.empty())
+                (!thisPtr->writeBufferList_.empty() ||
+                 !thisPtr->zeroCopyPending_.empty()))
             {
                 thisPtr->closeOnEmpty_ = true;
                 return;
@@ -391,7 +589,7 @@ void TcpConnectionImpl::sendInLoop(const char *buffer, size_t length)
         return;
     }
     ssize_t sendLen = 0;
-    if (!ioChannelPtr_->isWriting() && writeBufferList_.empty())
+    if (writeDirectly())
     {
         // send directly
         sendLen = writeInLoop(buffer, length);
@@ -405,13 +603,15 @@ void TcpConnectionImpl::sendInLoop(const char *buffer, size_t length)
     if (length > 0 && status_ == ConnStatus::Connected)
     {
         if (writeBufferList_.empty() || writeBufferList_.back()->isFile() ||
-            writeBufferList_.back()->isStream())
+            writeBufferList_.back()->isStream() ||
+            writeBufferList_.back()->isShared())
         {
-            writeBufferList_.push_back(BufferNode::newMemBufferNode());
+            pushWriteBufferNode(loop_->bufferNodePool().get());
         }
         writeBufferList_.back()->append(static_cast<const char *>(buffer) +
                                             sendLen,
                                         length);
+        queuedBytes_ += static_cast<long long>(length);
         if (highWaterMarkCallback_ &&
             writeBufferList_.back()->remainingBytes() >
                 static_cast<long long>(highWaterMarkLen_))
@@ -427,19 +627,185 @@ void TcpConnectionImpl::sendInLoop(const char *buffer, size_t length)
                 shared_from_this(),
                 tlsProviderPtr_->getBufferedData().readableBytes());
         }
+        updatePendingBytes();
     }
 }
+void TcpConnectionImpl::sendSharedInLoop(std::shared_ptr<const void> holder,
+                                         const char *data,
+                                         size_t length)
+{
+    loop_->assertInLoopThread();
+    if (tlsProviderPtr_)
+    {
+        // The data is copied anyway when it's encrypted
+        sendInLoop(data, length);
+        return;
+    }
+    if (status_ != ConnStatus::Connected)
+    {
+        LOG_DEBUG << "Connection is not connected,give up sending";
+        return;
+    }
+    if (zeroCopyThreshold_ > 0 && length >= zeroCopyThreshold_)
+    {
+        auto node = BufferNode::newSharedBufferNode(std::move(holder),
+                                                    data,
+                                                    length);
+        if (writeDirectly())
+        {
+            if (sendNodeInLoop(node) < 0)
+            {
+                LOG_TRACE << "write error";
+                return;
+            }
+            if (node->remainingBytes() == 0)
+                return;
+        }
+        pushWriteBufferNode(std::move(node));
+        if (highWaterMarkCallback_ &&
+            writeBufferList_.back()->remainingBytes() >
+                static_cast<long long>(highWaterMarkLen_))
+        {
+            highWaterMarkCallback_(shared_from_this(),
+                                   writeBufferList_.back()->remainingBytes());
+        }
+        updatePendingBytes();
+        return;
+    }
+    ssize_t sendLen = 0;
+    if (writeDirectly())
+    {
+        // send directly
+        sendLen = writeInLoop(data, length);
+        if (sendLen < 0)
+        {
+            LOG_TRACE << "write error";
+            return;
+        }
+        length -= sendLen;
+    }
+    if (length > 0 && status_ == ConnStatus::Connected)
+    {
+        pushWriteBufferNode(
+            BufferNode::newSharedBufferNode(std::move(holder),
+                                            data + sendLen,
+                                            length));
+        if (highWaterMarkCallback_ &&
+            writeBufferList_.back()->remainingBytes() >
+                static_cast<long long>(highWaterMarkLen_))
+        {
+            highWaterMarkCallback_(shared_from_this(),
+                                   writeBufferList_.back()->remainingBytes());
+        }
+        updatePendingBytes();
+    }
+}
+void TcpConnectionImpl::sendSharedInLoop(
+    const std::vector<std::shared_ptr<std::string>> &msgPtrs)
+{
+    loop_->assertInLoopThread();
+#ifndef _WIN32
+    if (tlsProviderPtr_ || status_ != ConnStatus::Connected)
+#endif
+    {
+        for (auto &msgPtr : msgPtrs)
+            sendSharedInLoop(msgPtr, msgPtr->data(), msgPtr->length());
+        return;
+    }
+#ifndef _WIN32
+    // The index of the first buffer not sent completely and the bytes of it
+    // already sent
+    size_t index = 0;
+    size_t offset = 0;
+    if (writeDirectly())
+    {
+        // send directly
+#ifdef IOV_MAX
+        static constexpr size_t kMaxIovecs = IOV_MAX;
+#else
+        static constexpr size_t kMaxIovecs = 16;
+#endif
+        struct iovec vecs[kMaxIovecs];
+        // Write batch after batch until the socket is full. In the edge
+        // triggered mode, only a full socket gets the writability edge that
+        // resumes sending.
+        while (index < msgPtrs.size())
+        {
+            size_t count = 0;
+            size_t total = 0;
+            for (size_t i = index; i < msgPtrs.size() && count < kMaxIovecs;
+                 ++i, ++count)
+            {
+                size_t skip = i == index ? offset : 0;
+                vecs[count].iov_base =
+                    const_cast<char *>(msgPtrs[i]->data()) + skip;
+                vecs[count].iov_len = msgPtrs[i]->length() - skip;
+                total += vecs[count].iov_len;
+            }
+            ssize_t nWritten = 0;
+            if (total > 0)
+                nWritten =
+                    ::writev(socketPtr_->fd(), vecs, static_cast<int>(count));
+            if (nWritten < 0)
+            {
+                if (!isEAGAIN())
+                {
+                    LOG_TRACE << "write error";
+                    return;
+                }
+                nWritten = 0;
+            }
+            bytesSent_ += nWritten;
+            size_t left = offset + static_cast<size_t>(nWritten);
+            while (index < msgPtrs.size() && left >= msgPtrs[index]->length())
+            {
+                left -= msgPtrs[index]->length();
+                ++index;
+            }
+            offset = left;
+            if (static_cast<size_t>(nWritten) < total)
+            {
+                LOG_TRACE << "nWritten = " << nWritten << " total = " << total;
+                break;
+            }
+        }
+        extendLife();
+        if (index == msgPtrs.size())
+            return;
+        ioChannelPtr_->enableWriting();
+    }
+    size_t queued = 0;
+    for (; index < msgPtrs.size(); ++index, offset = 0)
+    {
+        auto &msgPtr = msgPtrs[index];
+        if (msgPtr->length() == offset)
+            continue;
+        pushWriteBufferNode(
+            BufferNode::newSharedBufferNode(msgPtr,
+                                            msgPtr->data() + offset,
+                                            msgPtr->length() - offset));
+        queued += msgPtr->length() - offset;
+    }
+    if (highWaterMarkCallback_ && queued > highWaterMarkLen_)
+    {
+        highWaterMarkCallback_(shared_from_this(), queued);
+    }
+    updatePendingBytes();
+#endif
+}
 // The order of data sending should be same as the order of calls of send()
 void TcpConnectionImpl::send(const std::shared_ptr<std::string> &msgPtr)
 {
     if (loop_->isInLoopThread())
     {
-        sendInLoop(msgPtr->data(), msgPtr->length());
+        sendSharedInLoop(msgPtr, msgPtr->data(), msgPtr->length());
     }
     else
     {
         loop_->queueInLoop([thisPtr = shared_from_this(), msgPtr]() {
-            thisPtr->sendInLoop(msgPtr->data(), msgPtr->length());
+            thisPtr->sendSharedInLoop(msgPtr,
+                                      msgPtr->data(),
+                                      msgPtr->length());
         });
     }
 }
@@ -448,15 +814,41 @@ void TcpConnectionImpl::send(const std::shared_ptr<MsgBuffer> &msgPtr)
 {
     if (loop_->isInLoopThread())
     {
-        sendInLoop(msgPtr->peek(), msgPtr->readableBytes());
+        sendSharedInLoop(msgPtr, msgPtr->peek(), msgPtr->readableBytes());
     }
     else
     {
         loop_->queueInLoop([thisPtr = shared_from_this(), msgPtr]() {
-            thisPtr->sendInLoop(msgPtr->peek(), msgPtr->readableBytes());
+            thisPtr->sendSharedInLoop(msgPtr,
+                                      msgPtr->peek(),
+                                      msgPtr->readableBytes());
+        });
+    }
+}
+// The order of data sending should be same as the order of calls of send()
+void TcpConnectionImpl::send(
+    const std::vector<std::shared_ptr<std::string>> &msgPtrs)
+{
+    if (loop_->isInLoopThread())
+    {
+        sendSharedInLoop(msgPtrs);
+    }
+    else
+    {
+        loop_->queueInLoop([thisPtr = shared_from_this(), msgPtrs]() {
+            thisPtr->sendSharedInLoop(msgPtrs);
         });
     }
 }
+void TcpConnectionImpl::queueSendCopy(const char *data, size_t len)
+{
+    // The lambda is stored in place in the queue of the loop, only the chunk
+    // holding the copy of the data may be allocated
+    loop_->queueInLoop(
+        [thisPtr = shared_from_this(), chunk = SendChunk(data, len)]() {
+            thisPtr->sendInLoop(chunk.data(), chunk.size());
+        });
+}
 void TcpConnectionImpl::send(const char *msg, size_t len)
 {
     if (loop_->isInLoopThread())
@@ -465,11 +857,7 @@ void TcpConnectionImpl::send(const char *msg, size_t len)
     }
     else
     {
-        auto buffer = std::make_shared<std::string>(msg, len);
-        loop_->queueInLoop(
-            [thisPtr = shared_from_this(), buffer = std::move(buffer)]() {
-                thisPtr->sendInLoop(buffer->data(), buffer->length());
-            });
+        queueSendCopy(msg, len);
     }
 }
 void TcpConnectionImpl::send(const void *msg, size_t len)
@@ -484,12 +872,7 @@ void TcpConnectionImpl::send(const void *msg, size_t len)
     }
     else
     {
-        auto buffer =
-            std::make_shared<std::string>(static_cast<const char *>(msg), len);
-        loop_->queueInLoop(
-            [thisPtr = shared_from_this(), buffer = std::move(buffer)]() {
-                thisPtr->sendInLoop(buffer->data(), buffer->length());
-            });
+        queueSendCopy(static_cast<const char *>(msg), len);
     }
 }
 void TcpConnectionImpl::send(const std::string &msg)
@@ -500,9 +883,7 @@ void TcpConnectionImpl::send(const std::string &msg)
     }
     else
     {
-        loop_->queueInLoop([thisPtr = shared_from_this(), msg]() {
-            thisPtr->sendInLoop(msg.data(), msg.length());
-        });
+        queueSendCopy(msg.data(), msg.length());
     }
 }
 void TcpConnectionImpl::send(std::string &&msg)
@@ -528,9 +909,7 @@ void TcpConnectionImpl::send(const MsgBuffer &buffer)
     }
     else
     {
-        loop_->queueInLoop([thisPtr = shared_from_this(), buffer]() {
-            thisPtr->sendInLoop(buffer.peek(), buffer.readableBytes());
-        });
+        queueSendCopy(buffer.peek(), buffer.readableBytes());
     }
 }
 
@@ -595,12 +974,12 @@ void TcpConnectionImpl::sendFile(BufferNodePtr &&fileNode)
         {
             auto n = sendNodeInLoop(fileNode);
             if (fileNode->remainingBytes() > 0 && n >= 0)
-                writeBufferList_.push_back(std::move(fileNode));
+                pushWriteBufferNode(std::move(fileNode));
             return;
         }
         else
         {
-            writeBufferList_.push_back(std::move(fileNode));
+            pushWriteBufferNode(std::move(fileNode));
         }
     }
     else
@@ -611,11 +990,11 @@ void TcpConnectionImpl::sendFile(BufferNodePtr &&fileNode)
             {
                 auto n = thisPtr->sendNodeInLoop(node);
                 if (node->remainingBytes() > 0 && n >= 0)
-                    thisPtr->writeBufferList_.push_back(std::move(node));
+                    thisPtr->pushWriteBufferNode(std::move(node));
             }
             else
             {
-                thisPtr->writeBufferList_.push_back(std::move(node));
+                thisPtr->pushWriteBufferNode(std::move(node));
             }
         });
     }
@@ -631,7 +1010,7 @@ void TcpConnectionImpl::sendStream(
         {
             auto n = sendNodeInLoop(node);
             if (node->remainingBytes() > 0 && n >= 0)
-                writeBufferList_.push_back(std::move(node));
+                pushWriteBufferNode(std::move(node));
             return;
         }
     }
@@ -644,11 +1023,11 @@ void TcpConnectionImpl::sendStream(
                 {
                     auto n = thisPtr->sendNodeInLoop(node);
                     if (node->remainingBytes() > 0 && n >= 0)
-                        thisPtr->writeBufferList_.push_back(std::move(node));
+                        thisPtr->pushWriteBufferNode(std::move(node));
                 }
                 else
                 {
-                    thisPtr->writeBufferList_.push_back(std::move(node));
+                    thisPtr->pushWriteBufferNode(std::move(node));
                 }
             });
     }
@@ -690,6 +1069,8 @@ ssize_t TcpConnectionImpl::sendNodeInLoop(const BufferNodePtr &nodePtr)
         }
         return bytesSent;
     }
+    if (useZeroCopy(nodePtr))
+        return sendZeroCopyInLoop(nodePtr);
 #endif
     // Send stream
 
@@ -725,7 +1106,191 @@ ssize_t TcpConnectionImpl::sendNodeInLoop(const BufferNodePtr &nodePtr)
     }
     return hasSent;
 }
+#ifdef __linux__
+ssize_t TcpConnectionImpl::sendZeroCopyInLoop(const BufferNodePtr &nodePtr)
+{
+    LOG_TRACE << "send node in loop with MSG_ZEROCOPY";
+    const char *data;
+    size_t len;
+    nodePtr->getData(data, len);
+    auto nWritten = ::send(socketPtr_->fd(), data, len, MSG_ZEROCOPY);
+    if (nWritten < 0 && errno == ENOBUFS)
+    {
+        // Out of the memory for pinning pages, copy this chunk
+        nWritten = writeRaw(data, len);
+        if (nWritten > 0)
+            nodePtr->retrieve(nWritten);
+        return nWritten;
+    }
+    if (nWritten > 0)
+    {
+        bytesSent_ += nWritten;
+        nodePtr->retrieve(nWritten);
+        // The kernel reads the data until the completion is reported
+        zeroCopyPending_.emplace_back(zeroCopyNextId_++, nodePtr);
+    }
+    else if (!isEAGAIN())
+        return -1;
+    else
+        nWritten = 0;
+    if (nodePtr->remainingBytes() > 0)
+    {
+        LOG_TRACE << "nWritten = " << nWritten << " length = " << len;
+        if (!ioChannelPtr_->isWriting())
+            ioChannelPtr_->enableWriting();
+    }
+    extendLife();
+    return nWritten;
+}
+// Pop the nodes of the sends whose completions are in the error queue of fd
+static void drainZeroCopyCompletions(
+    int fd,
+    std::deque<std::pair<uint32_t, BufferNodePtr>> &pending)
+{
+    char control[128];
+    while (!pending.empty())
+    {
+        struct msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+                !(cmsg->cmsg_level == SOL_IPV6 &&
+                  cmsg->cmsg_type == IPV6_RECVERR))
+                continue;
+            auto err = reinterpret_cast<struct sock_extended_err *>(
+                CMSG_DATA(cmsg));
+            if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            // The sends with ids in [ee_info, ee_data] are completed
+            auto last = err->ee_data;
+            while (!pending.empty() &&
+                   static_cast<int32_t>(pending.front().first - last) <= 0)
+            {
+                pending.pop_front();
+            }
+        }
+    }
+}
+void TcpConnectionImpl::handleZeroCopyCompletions()
+{
+    drainZeroCopyCompletions(socketPtr_->fd(), zeroCopyPending_);
+    // shutdown() waits for the kernel to release the buffers
+    if (closeOnEmpty_ && zeroCopyPending_.empty() && writeBufferList_.empty())
+        shutdown();
+}
+void TcpConnectionImpl::lingerZeroCopySends()
+{
+    loop_->assertInLoopThread();
+    if (zeroCopyPending_.empty())
+        return;
+    drainZeroCopyCompletions(socketPtr_->fd(), zeroCopyPending_);
+    if (zeroCopyPending_.empty())
+        return;
+    // A duplicate keeps the socket open after the connection closes its fd,
+    // the completions of the sends are read from it until the last one.
+    struct Linger
+    {
+        int fd;
+        std::deque<std::pair<uint32_t, BufferNodePtr>> pending;
+        TimerId timerId;
+    };
+    auto linger = std::make_shared<Linger>();
+    linger->fd = ::dup(socketPtr_->fd());
+    if (linger->fd < 0)
+    {
+        LOG_SYSERR << "dup() of a socket with pending MSG_ZEROCOPY sends";
+        return;
+    }
+    // The peer still gets the end of the stream as if the socket was closed
+    ::shutdown(linger->fd, SHUT_WR);
+    linger->pending.swap(zeroCopyPending_);
+    auto loop = loop_;
+    linger->timerId = loop_->runEvery(0.01, [loop, linger]() {
+        drainZeroCopyCompletions(linger->fd, linger->pending);
+        if (linger->pending.empty())
+        {
+            ::close(linger->fd);
+            loop->invalidateTimer(linger->timerId);
+        }
+    });
+}
+#endif
 #ifndef _WIN32
+ssize_t TcpConnectionImpl::writevNodesInLoop(bool &sentAll)
+{
+    loop_->assertInLoopThread();
+#ifdef IOV_MAX
+    static constexpr int kMaxIovecs = IOV_MAX;
+#else
+    static constexpr int kMaxIovecs = 16;
+#endif
+    struct iovec vecs[kMaxIovecs];
+    const char *data[kMaxIovecs];
+    size_t len[kMaxIovecs];
+    int count = 0;
+    size_t total = 0;
+    for (auto &node : writeBufferList_)
+    {
+        if (!node->isMemory() || count == kMaxIovecs ||
+            (count > 0 && useZeroCopy(node)))
+            break;
+        auto n = node->getSegments(data + count, len + count, kMaxIovecs - count);
+        size_t nodeLen = 0;
+        for (size_t i = count; i < count + n; ++i)
+        {
+            vecs[i].iov_base = const_cast<char *>(data[i]);
+            vecs[i].iov_len = len[i];
+            nodeLen += len[i];
+        }
+        count += static_cast<int>(n);
+        total += nodeLen;
+        // The rest of the node doesn't fit in vecs
+        if (static_cast<long long>(nodeLen) < node->remainingBytes())
+            break;
+    }
+    sentAll = false;
+    ssize_t nWritten = ::writev(socketPtr_->fd(), vecs, count);
+    if (nWritten < 0)
+    {
+        if (!isEAGAIN())
+            return -1;
+        return 0;
+    }
+    sentAll = static_cast<size_t>(nWritten) == total;
+    bytesSent_ += nWritten;
+    // retrieve the written bytes node by node, a partial write stops in the
+    // middle of a node which stays at the front of the list
+    size_t left = static_cast<size_t>(nWritten);
+    while (left > 0 && !writeBufferList_.empty())
+    {
+        auto &node = writeBufferList_.front();
+        size_t len = static_cast<size_t>(node->remainingBytes());
+        if (left < len)
+        {
+            node->retrieve(left);
+            queuedBytes_ -= static_cast<long long>(left);
+            break;
+        }
+        node->retrieve(len);
+        queuedBytes_ -= static_cast<long long>(len);
+        left -= len;
+        popWriteBufferNode();
+    }
+    if (static_cast<size_t>(nWritten) < total)
+    {
+        LOG_TRACE << "nWritten = " << nWritten << " total = " << total;
+        if (!ioChannelPtr_->isWriting())
+            ioChannelPtr_->enableWriting();
+    }
+    extendLife();
+    return nWritten;
+}
+
 ssize_t TcpConnectionImpl::writeRaw(const void *buffer, size_t length)
 #else
 ssize_t TcpConnectionImpl::writeRaw(const char *buffer, size_t length)
@@ -931,7 +1496,7 @@ AsyncStreamPtr TcpConnectionImpl::sendAsyncStream(bool disableKickoff)
             idleTimeout_ = 0;
         }
 
-        writeBufferList_.push_back(asyncStreamNode);
+        pushWriteBufferNode(asyncStreamNode);
     }
     else
     {
@@ -955,11 +1520,11 @@ AsyncStreamPtr TcpConnectionImpl::sendAsyncStream(bool disableKickoff)
             {
                 auto n = thisPtr->sendNodeInLoop(node);
                 if (n >= 0 && (node->remainingBytes() > 0 || node->available()))
-                    thisPtr->writeBufferList_.push_back(std::move(node));
+                    thisPtr->pushWriteBufferNode(std::move(node));
             }
             else
             {
-                thisPtr->writeBufferList_.push_back(std::move(node));
+                thisPtr->pushWriteBufferNode(std::move(node));
             }
         });
     }
@@ -986,11 +1551,13 @@ void TcpConnectionImpl::sendAsyncDataInLoop(const BufferNodePtr &node,
                 if (static_cast<size_t>(nWritten) < len)
                 {
                     node->append(data + nWritten, len - nWritten);
+                    queuedBytes_ += static_cast<long long>(len - nWritten);
                 }
             }
             else
             {
                 node->append(data, len);
+                queuedBytes_ += static_cast<long long>(len);
             }
         }
     }
@@ -1000,7 +1567,12 @@ void TcpConnectionImpl::sendAsyncDataInLoop(const BufferNodePtr &node,
         node->done();
         if (!writeBufferList_.empty() && node == writeBufferList_.front() &&
             !ioChannelPtr_->isWriting())
+        {
             ioChannelPtr_->enableWriting();
+            // The socket didn't fill up, no writable event would come
+            if (ioChannelPtr_->isEdgeTriggered())
+                sendBufferedInLoop();
+        }
 
         if (idleTimeoutBackup_ > 0)
         {
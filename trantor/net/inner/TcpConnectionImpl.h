@@ -18,6 +18,7 @@
 #include <trantor/utils/TimingWheel.h>
 #include <trantor/net/inner/TLSProvider.h>
 #include <trantor/net/inner/BufferNode.h>
+#include <deque>
 #include <list>
 #include <mutex>
 #ifndef _WIN32
@@ -78,6 +79,8 @@ class TcpConnectionImpl : public TcpConnection,
     void send(MsgBuffer &&buffer) override;
     void send(const std::shared_ptr<std::string> &msgPtr) override;
     void send(const std::shared_ptr<MsgBuffer> &msgPtr) override;
+    void send(
+        const std::vector<std::shared_ptr<std::string>> &msgPtrs) override;
     void sendFile(const char *fileName,
                   long long offset,
                   long long length) override;
@@ -132,6 +135,13 @@ class TcpConnectionImpl : public TcpConnection,
         return idleTimeout_ == 0;
     }
     void setTcpNoDelay(bool on) override;
+    void setPriority(ChannelPriority priority) override;
+    void setZeroCopyThreshold(size_t threshold) override;
+    void setBatchSend(bool on) override;
+    void flush() override;
+    void setReadSizeQuery(bool on) override;
+    void setReadBudget(size_t bytes) override;
+    void setEdgeTriggered(bool on) override;
     void shutdown() override;
     void forceClose() override;
     EventLoop *getLoop() override
@@ -229,6 +239,23 @@ class TcpConnectionImpl : public TcpConnection,
     std::list<BufferNodePtr> writeBufferList_;
     void readCallback();
     void writeCallback();
+    // Send the data in writeBufferList_ as far as the socket takes it
+    void sendBufferedInLoop();
+    // Remove the sent node at the front, memory nodes go back to the pool of
+    // the loop
+    void popWriteBufferNode();
+    void pushWriteBufferNode(BufferNodePtr node)
+    {
+        queuedBytes_ += node->remainingBytes();
+        writeBufferList_.push_back(std::move(node));
+    }
+    // Whether new data can be written right away, otherwise it's queued. In
+    // batch mode a flush at the end of the loop iteration is scheduled.
+    bool writeDirectly();
+    void flushInLoop();
+    // Report the bytes in the write buffers to the loop statistics
+    void updatePendingBytes();
+    void releaseConnectionStats();
     InetAddress localAddr_, peerAddr_;
     ConnStatus status_{ConnStatus::Connecting};
     void handleClose();
@@ -239,7 +266,36 @@ class TcpConnectionImpl : public TcpConnection,
                              size_t len);
     // -1: error, 0: EAGAIN, >0: bytes sent
     ssize_t sendNodeInLoop(const BufferNodePtr &node);
+    // Send the data kept alive by holder, the unsent part is queued without
+    // being copied
+    void sendSharedInLoop(std::shared_ptr<const void> holder,
+                          const char *data,
+                          size_t length);
+    void sendSharedInLoop(
+        const std::vector<std::shared_ptr<std::string>> &msgPtrs);
+    // Send a copy of the data from a thread other than the loop thread
+    void queueSendCopy(const char *data, size_t len);
+    bool useZeroCopy(const BufferNodePtr &node) const
+    {
+        return zeroCopyThreshold_ > 0 && !tlsProviderPtr_ &&
+               node->isShared() &&
+               node->remainingBytes() >=
+                   static_cast<long long>(zeroCopyThreshold_);
+    }
+#ifdef __linux__
+    // -1: error, 0: EAGAIN, >0: bytes sent
+    ssize_t sendZeroCopyInLoop(const BufferNodePtr &node);
+    // Release the nodes whose MSG_ZEROCOPY sends were completed
+    void handleZeroCopyCompletions();
+    // Hand the nodes of the uncompleted sends to the loop, which keeps them
+    // until their completions are reported
+    void lingerZeroCopySends();
+#endif
 #ifndef _WIN32
+    // Write the memory nodes at the front of writeBufferList_ with writev(),
+    // sentAll is set if all the gathered data was written.
+    // -1: error, 0: EAGAIN, >0: bytes sent
+    ssize_t writevNodesInLoop(bool &sentAll);
     void sendInLoop(const void *buffer, size_t length);
     ssize_t writeRaw(const void *buffer, size_t length);
     ssize_t writeInLoop(const void *buffer, size_t length);
@@ -261,6 +317,24 @@ class TcpConnectionImpl : public TcpConnection,
     std::function<void(const TcpConnectionPtr &)> upgradeCallback_;
 
     bool closeOnEmpty_{false};
+    // The part of the loop statistics contributed by this connection
+    bool countedInLoop_{true};
+    long long pendingBytes_{0};
+    // The bytes left in writeBufferList_, kept up to date as nodes are
+    // queued, written and popped
+    long long queuedBytes_{0};
+
+    bool batchSend_{false};
+    bool flushScheduled_{false};
+    bool readSizeQuery_{false};
+    size_t readBudget_{0};
+
+    size_t zeroCopyThreshold_{0};
+    bool zeroCopyEnabled_{false};
+    // The nodes referenced by the kernel, keyed by the notification id of the
+    // MSG_ZEROCOPY send
+    uint32_t zeroCopyNextId_{0};
+    std::deque<std::pair<uint32_t, BufferNodePtr>> zeroCopyPending_;
 
     static void onSslError(TcpConnection *self, SSLError err);
     static void onHandshakeFinished(TcpConnection *self);
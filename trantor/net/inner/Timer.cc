@@ -19,17 +19,7 @@
 namespace trantor
 {
 std::atomic<TimerId> Timer::timersCreated_ = ATOMIC_VAR_INIT(InvalidTimerId);
-Timer::Timer(const TimerCallback &cb,
-             const TimePoint &when,
-             const TimeInterval &interval)
-    : callback_(cb),
-      when_(when),
-      interval_(interval),
-      repeat_(interval.count() > 0),
-      id_(++timersCreated_)
-{
-}
-Timer::Timer(TimerCallback &&cb,
+Timer::Timer(LoopFunc &&cb,
              const TimePoint &when,
              const TimeInterval &interval)
     : callback_(std::move(cb)),
@@ -16,6 +16,7 @@
 
 #include <trantor/utils/NonCopyable.h>
 #include <trantor/net/callbacks.h>
+#include <trantor/net/EventLoop.h>
 #include <functional>
 #include <atomic>
 #include <iostream>
@@ -29,12 +30,7 @@ using TimeInterval = std::chrono::microseconds;
 class Timer : public NonCopyable
 {
   public:
-    Timer(const TimerCallback &cb,
-          const TimePoint &when,
-          const TimeInterval &interval);
-    Timer(TimerCallback &&cb,
-          const TimePoint &when,
-          const TimeInterval &interval);
+    Timer(LoopFunc &&cb, const TimePoint &when, const TimeInterval &interval);
     ~Timer()
     {
         //   std::cout<<"Timer unconstract!"<<std::endl;
@@ -57,7 +53,7 @@ class Timer : public NonCopyable
     }
 
   private:
-    TimerCallback callback_;
+    LoopFunc callback_;
     TimePoint when_;
     const TimeInterval interval_;
     const bool repeat_;
@@ -146,6 +146,7 @@ TimerQueue::TimerQueue(EventLoop *loop)
     timerfdChannelPtr_->setReadCallback(
         std::bind(&TimerQueue::handleRead, this));
     // we are always reading the timerfd, we disarm it with timerfd_settime.
+    timerfdChannelPtr_->setPriority(ChannelPriority::High);
     timerfdChannelPtr_->enableReading();
 #endif
 }
@@ -160,6 +161,7 @@ void TimerQueue::reset()
         timerfdChannelPtr_ = std::make_shared<Channel>(loop_, timerfd_);
         timerfdChannelPtr_->setReadCallback(
             std::bind(&TimerQueue::handleRead, this));
+        timerfdChannelPtr_->setPriority(ChannelPriority::High);
         // we are always reading the timerfd, we disarm it with timerfd_settime.
         timerfdChannelPtr_->enableReading();
         if (!timers_.empty())
@@ -183,17 +185,7 @@ TimerQueue::~TimerQueue()
 #endif
 }
 
-TimerId TimerQueue::addTimer(const TimerCallback &cb,
-                             const TimePoint &when,
-                             const TimeInterval &interval)
-{
-    std::shared_ptr<Timer> timerPtr =
-        std::make_shared<Timer>(cb, when, interval);
-
-    loop_->runInLoop([this, timerPtr]() { addTimerInLoop(timerPtr); });
-    return timerPtr->id();
-}
-TimerId TimerQueue::addTimer(TimerCallback &&cb,
+TimerId TimerQueue::addTimer(LoopFunc &&cb,
                              const TimePoint &when,
                              const TimeInterval &interval)
 {
@@ -40,10 +40,7 @@ class TimerQueue : NonCopyable
   public:
     explicit TimerQueue(EventLoop *loop);
     ~TimerQueue();
-    TimerId addTimer(const TimerCallback &cb,
-                     const TimePoint &when,
-                     const TimeInterval &interval);
-    TimerId addTimer(TimerCallback &&cb,
+    TimerId addTimer(LoopFunc &&cb,
                      const TimePoint &when,
                      const TimeInterval &interval);
     void addTimerInLoop(const TimerPtr &timer);
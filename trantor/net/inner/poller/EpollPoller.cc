@@ -47,7 +47,6 @@ namespace
 {
 const int kNew = -1;
 const int kAdded = 1;
-const int kDeleted = 2;
 }  // namespace
 
 EpollPoller::EpollPoller(EventLoop *loop)
@@ -77,6 +76,7 @@ void EpollPoller::postEvent(uint64_t event)
 #endif
 void EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
+    applyUpdates();
     int numEvents = ::epoll_wait(epollfd_,
                                  &*events_.begin(),
                                  static_cast<int>(events_.size()),
@@ -87,10 +87,6 @@ void EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
     {
         // LOG_TRACE << numEvents << " events happended";
         fillActiveChannels(numEvents, activeChannels);
-        if (static_cast<size_t>(numEvents) == events_.size())
-        {
-            events_.resize(events_.size() * 2);
-        }
     }
     else if (numEvents == 0)
     {
@@ -105,6 +101,17 @@ void EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
             LOG_SYSERR << "EPollEpollPoller::poll()";
         }
     }
+    if (numEvents >= 0)
+    {
+        recordPollEvents(static_cast<size_t>(numEvents));
+        size_t size =
+            nextEventBatchSize(events_.size(), static_cast<size_t>(numEvents));
+        if (size != events_.size())
+        {
+            events_.resize(size);
+            events_.shrink_to_fit();
+        }
+    }
     return;
 }
 void EpollPoller::fillActiveChannels(int numEvents,
@@ -121,92 +128,112 @@ void EpollPoller::fillActiveChannels(int numEvents,
         }
 #endif
         Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
-#ifndef NDEBUG
-        int fd = channel->fd();
-        ChannelMap::const_iterator it = channels_.find(fd);
-        assert(it != channels_.end());
-        assert(it->second == channel);
-#endif
+        assert(static_cast<size_t>(channel->fd()) < registrations_.size());
+        assert(registrations_[channel->fd()].channel == channel);
         channel->setRevents(events_[i].events);
         activeChannels->push_back(channel);
     }
     // LOG_TRACE<<"active Channels num:"<<activeChannels->size();
 }
+EpollPoller::Registration &EpollPoller::registration(int fd)
+{
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= registrations_.size())
+        registrations_.resize(fd + 1);
+    return registrations_[fd];
+}
 void EpollPoller::updateChannel(Channel *channel)
 {
     assertInLoopThread();
     assert(channel->fd() >= 0);
 
-    const int index = channel->index();
+    int fd = channel->fd();
+    auto &reg = registration(fd);
     // LOG_TRACE << "fd = " << channel->fd()
     //  << " events = " << channel->events() << " index = " << index;
-    if (index == kNew || index == kDeleted)
+    if (channel->index() == kNew)
     {
-// a new one, add with EPOLL_CTL_ADD
-#ifndef NDEBUG
-        int fd = channel->fd();
-        if (index == kNew)
-        {
-            assert(channels_.find(fd) == channels_.end());
-            channels_[fd] = channel;
-        }
-        else
-        {  // index == kDeleted
-            assert(channels_.find(fd) != channels_.end());
-            assert(channels_[fd] == channel);
-        }
-#endif
+        assert(reg.channel == nullptr);
+        reg.channel = channel;
         channel->setIndex(kAdded);
-        update(EPOLL_CTL_ADD, channel);
     }
-    else
+    assert(channel->index() == kAdded);
+    assert(reg.channel == channel);
+    // The change is applied by the next poll()
+    if (!reg.dirty)
     {
-// update existing one with EPOLL_CTL_MOD/DEL
-#ifndef NDEBUG
-        int fd = channel->fd();
-        (void)fd;
-        assert(channels_.find(fd) != channels_.end());
-        assert(channels_[fd] == channel);
-#endif
-        assert(index == kAdded);
-        if (channel->isNoneEvent())
-        {
-            update(EPOLL_CTL_DEL, channel);
-            channel->setIndex(kDeleted);
-        }
-        else
-        {
-            update(EPOLL_CTL_MOD, channel);
-        }
+        reg.dirty = true;
+        dirtyFds_.push_back(fd);
     }
 }
 void EpollPoller::removeChannel(Channel *channel)
 {
     EpollPoller::assertInLoopThread();
-#ifndef NDEBUG
     int fd = channel->fd();
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
-    size_t n = channels_.erase(fd);
-    (void)n;
-    assert(n == 1);
-#endif
     assert(channel->isNoneEvent());
-    int index = channel->index();
-    assert(index == kAdded || index == kDeleted);
-    if (index == kAdded)
+    assert(channel->index() == kAdded);
+    auto &reg = registration(fd);
+    assert(reg.channel == channel);
+    // The fd is usually closed right after, so the removal isn't deferred.
+    // The fd stays in the dirty list if it's there, the entry is skipped
+    // unless a new channel takes the fd before the next poll().
+    if (reg.added)
+        update(EPOLL_CTL_DEL, fd, 0, channel);
+    reg.channel = nullptr;
+    reg.events = 0;
+    reg.added = false;
+    channel->setIndex(kNew);
+}
+void EpollPoller::applyUpdates()
+{
+    for (int fd : dirtyFds_)
     {
-        update(EPOLL_CTL_DEL, channel);
+        auto &reg = registrations_[fd];
+        reg.dirty = false;
+        Channel *channel = reg.channel;
+        if (channel == nullptr)
+            continue;
+        if (channel->isNoneEvent())
+        {
+            if (reg.added)
+            {
+                update(EPOLL_CTL_DEL, fd, 0, channel);
+                reg.added = false;
+            }
+            continue;
+        }
+        uint32_t events = static_cast<uint32_t>(channel->events());
+#ifdef __linux__
+        // Edge triggered channels always wait for writability, the channel
+        // ignores the notifications it doesn't want, so toggling the write
+        // interest costs no epoll_ctl() call
+        if (channel->isEdgeTriggered())
+            events |= EPOLLOUT | EPOLLET;
+#endif
+        if (!reg.added)
+        {
+            update(EPOLL_CTL_ADD, fd, events, channel);
+            reg.added = true;
+            reg.events = events;
+        }
+        else if (reg.events != events)
+        {
+            update(EPOLL_CTL_MOD, fd, events, channel);
+            reg.events = events;
+        }
     }
-    channel->setIndex(kNew);
+    dirtyFds_.clear();
 }
-void EpollPoller::update(int operation, Channel *channel)
+void EpollPoller::update(int operation,
+                         int fd,
+                         uint32_t events,
+                         Channel *channel)
 {
     struct epoll_event event;
     memset(&event, 0, sizeof(event));
-    event.events = channel->events();
+    event.events = events;
     event.data.ptr = channel;
-    int fd = channel->fd();
+    countInterestUpdate();
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
         if (operation == EPOLL_CTL_DEL)
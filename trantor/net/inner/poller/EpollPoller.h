@@ -20,13 +20,19 @@
 
 #if defined __linux__ || defined _WIN32
 #include <memory>
-#include <map>
+#include <vector>
 using EventList = std::vector<struct epoll_event>;
 #endif
 namespace trantor
 {
 class Channel;
 
+/**
+ * The poller backed by epoll. The changes of the watched events are recorded
+ * and applied by the next poll() call, so a channel toggling its events
+ * several times while handling events costs at most one epoll_ctl() call, and
+ * none if it ends up watching the events already registered.
+ */
 class EpollPoller : public Poller
 {
   public:
@@ -35,6 +41,12 @@ class EpollPoller : public Poller
     virtual void poll(int timeoutMs, ChannelList *activeChannels) override;
     virtual void updateChannel(Channel *channel) override;
     virtual void removeChannel(Channel *channel) override;
+#ifdef __linux__
+    virtual bool supportsEdgeTriggered() const override
+    {
+        return true;
+    }
+#endif
 #ifdef _WIN32
     virtual void postEvent(uint64_t event) override;
     virtual void setEventCallback(const EventCallback &cb) override
@@ -53,11 +65,19 @@ class EpollPoller : public Poller
     int epollfd_;
 #endif
     EventList events_;
-    void update(int operation, Channel *channel);
-#ifndef NDEBUG
-    using ChannelMap = std::map<int, Channel *>;
-    ChannelMap channels_;
-#endif
+    struct Registration
+    {
+        Channel *channel{nullptr};
+        // The events registered in the epoll instance, valid if added is true
+        uint32_t events{0};
+        bool added{false};
+        bool dirty{false};
+    };
+    std::vector<Registration> registrations_;
+    std::vector<int> dirtyFds_;
+    Registration &registration(int fd);
+    void applyUpdates();
+    void update(int operation, int fd, uint32_t events, Channel *channel);
     void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
 #endif
 };
@@ -0,0 +1,362 @@
+/**
+ *
+ *  IoUringPoller.cc
+ *  An Tao
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  https://github.com/an-tao/trantor
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *  Trantor
+ *
+ */
+
+#include "IoUringPoller.h"
+#include "Channel.h"
+#ifdef USE_IO_URING
+#include <trantor/utils/Logger.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#endif
+namespace trantor
+{
+#ifdef USE_IO_URING
+namespace
+{
+const int kNew = -1;
+const int kAdded = 1;
+
+const unsigned kSqEntries = 1024;
+// The user data of the poll removal requests, their completions are ignored
+const uint64_t kRemoveUserData = ~0ULL;
+
+uint64_t makeUserData(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 32) |
+           static_cast<uint32_t>(fd);
+}
+}  // namespace
+
+IoUringPoller::IoUringPoller(EventLoop *loop) : Poller(loop)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(
+        ::syscall(__NR_io_uring_setup, kSqEntries, &params));
+    if (fd < 0)
+    {
+        LOG_DEBUG << "io_uring_setup() failed, errno=" << errno;
+        return;
+    }
+    // The timeout of io_uring_enter() needs IORING_FEAT_EXT_ARG (Linux 5.11)
+    if (!(params.features & IORING_FEAT_EXT_ARG) ||
+        !(params.features & IORING_FEAT_NODROP))
+    {
+        LOG_DEBUG << "io_uring lacks the features used by the poller";
+        close(fd);
+        return;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (cqRingSize_ > sqRingSize_)
+            sqRingSize_ = cqRingSize_;
+        cqRingSize_ = 0;
+    }
+    sqRing_ = ::mmap(nullptr,
+                     sqRingSize_,
+                     PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE,
+                     fd,
+                     IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        sqRing_ = nullptr;
+        close(fd);
+        return;
+    }
+    if (cqRingSize_ == 0)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr,
+                         cqRingSize_,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         fd,
+                         IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            cqRing_ = nullptr;
+            ::munmap(sqRing_, sqRingSize_);
+            sqRing_ = nullptr;
+            close(fd);
+            return;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(nullptr,
+                        sqesSize_,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        fd,
+                        IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        if (cqRingSize_ != 0)
+            ::munmap(cqRing_, cqRingSize_);
+        ::munmap(sqRing_, sqRingSize_);
+        sqRing_ = cqRing_ = nullptr;
+        close(fd);
+        return;
+    }
+    sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+    auto sq = static_cast<char *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqLocalTail_ = *sqTail_;
+    auto cq = static_cast<char *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    ringFd_ = fd;
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (ringFd_ < 0)
+        return;
+    ::munmap(sqes_, sqesSize_);
+    if (cqRingSize_ != 0)
+        ::munmap(cqRing_, cqRingSize_);
+    ::munmap(sqRing_, sqRingSize_);
+    close(ringFd_);
+}
+
+IoUringPoller::Entry &IoUringPoller::entry(int fd)
+{
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= entries_.size())
+        entries_.resize(fd + 1);
+    return entries_[fd];
+}
+
+void IoUringPoller::markDirty(int fd)
+{
+    auto &e = entries_[fd];
+    if (!e.dirty)
+    {
+        e.dirty = true;
+        dirtyFds_.push_back(fd);
+    }
+}
+
+struct io_uring_sqe *IoUringPoller::getSqe()
+{
+    if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) ==
+        sqEntries_)
+    {
+        // The submission queue is full, submit it without waiting
+        countInterestUpdate();
+        enter(toSubmit_, 0, 0);
+        assert(sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) <
+               sqEntries_);
+    }
+    unsigned index = sqLocalTail_ & sqMask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    ++toSubmit_;
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+int IoUringPoller::enter(unsigned toSubmit,
+                         unsigned minComplete,
+                         int timeoutMs)
+{
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    unsigned flags = IORING_ENTER_EXT_ARG | IORING_ENTER_GETEVENTS;
+    int ret = static_cast<int>(::syscall(__NR_io_uring_enter,
+                                         ringFd_,
+                                         toSubmit,
+                                         minComplete,
+                                         flags,
+                                         &arg,
+                                         sizeof(arg)));
+    // The requests not consumed by the kernel are submitted next time
+    toSubmit_ = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    return ret;
+}
+
+void IoUringPoller::armDirtyChannels()
+{
+    for (int fd : dirtyFds_)
+    {
+        auto &e = entries_[fd];
+        e.dirty = false;
+        if (e.armed || e.channel == nullptr || e.channel->isNoneEvent())
+            continue;
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = static_cast<uint32_t>(e.channel->events());
+        sqe->user_data = makeUserData(fd, e.generation);
+        e.armed = true;
+        e.armedEvents = e.channel->events();
+    }
+    dirtyFds_.clear();
+}
+
+void IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    armDirtyChannels();
+    // Entering the kernel also lets it post the completions of the polls
+    // which fired, so it is done even when not waiting
+    int ret = enter(toSubmit_, timeoutMs != 0 ? 1 : 0, timeoutMs);
+    int savedErrno = errno;
+    if (ret < 0 && savedErrno != ETIME && savedErrno != EINTR &&
+        savedErrno != EBUSY)
+    {
+        errno = savedErrno;
+        LOG_SYSERR << "IoUringPoller::poll()";
+    }
+    size_t activeBefore = activeChannels->size();
+    fillActiveChannels(activeChannels);
+    recordPollEvents(activeChannels->size() - activeBefore);
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe &cqe = cqes_[head & cqMask_];
+        if (cqe.user_data == kRemoveUserData)
+            continue;
+        int fd = static_cast<int>(cqe.user_data & 0xffffffffULL);
+        uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+        if (static_cast<size_t>(fd) >= entries_.size())
+            continue;
+        auto &e = entries_[fd];
+        if (e.generation != generation || e.channel == nullptr)
+            continue;
+        e.armed = false;
+        if (cqe.res < 0)
+        {
+            // The request would fail again, the channel gets the error and is
+            // only polled again once its events are updated
+            LOG_ERROR << "poll request failed, fd=" << fd
+                      << " errno=" << -cqe.res;
+            e.channel->setRevents(cqe.res == -EBADF ? POLLNVAL : POLLERR);
+            activeChannels->push_back(e.channel);
+            continue;
+        }
+        // The polls are one-shot, the channel is polled again in the next
+        // iteration if it still has events to watch
+        markDirty(fd);
+        e.channel->setRevents(cqe.res);
+        activeChannels->push_back(e.channel);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    assertInLoopThread();
+    int fd = channel->fd();
+    auto &e = entry(fd);
+    if (channel->index() == kNew)
+    {
+        assert(e.channel == nullptr);
+        e.channel = channel;
+        channel->setIndex(kAdded);
+    }
+    assert(e.channel == channel);
+    if (e.armed)
+    {
+        if (e.armedEvents == channel->events())
+            return;
+        // Replace the poll request
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = makeUserData(fd, e.generation);
+        sqe->user_data = kRemoveUserData;
+        e.armed = false;
+        ++e.generation;
+    }
+    if (!channel->isNoneEvent())
+        markDirty(fd);
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    assertInLoopThread();
+    assert(channel->isNoneEvent());
+    int fd = channel->fd();
+    auto &e = entry(fd);
+    assert(e.channel == channel);
+    if (e.armed)
+    {
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = makeUserData(fd, e.generation);
+        sqe->user_data = kRemoveUserData;
+        e.armed = false;
+    }
+    ++e.generation;
+    e.channel = nullptr;
+    channel->setIndex(kNew);
+}
+#else
+IoUringPoller::IoUringPoller(EventLoop *loop) : Poller(loop)
+{
+}
+IoUringPoller::~IoUringPoller()
+{
+}
+void IoUringPoller::poll(int, ChannelList *)
+{
+}
+void IoUringPoller::updateChannel(Channel *)
+{
+}
+void IoUringPoller::removeChannel(Channel *)
+{
+}
+#endif
+}  // namespace trantor
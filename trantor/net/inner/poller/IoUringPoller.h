@@ -0,0 +1,102 @@
+/**
+ *
+ *  IoUringPoller.h
+ *  An Tao
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  https://github.com/an-tao/trantor
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *  Trantor
+ *
+ */
+
+#pragma once
+#include "../Poller.h"
+#include <trantor/utils/NonCopyable.h>
+#include <trantor/net/EventLoop.h>
+
+#if defined __linux__ && defined __has_include
+#if __has_include(<linux/io_uring.h>)
+#define USE_IO_URING
+#include <vector>
+struct io_uring_sqe;
+struct io_uring_cqe;
+#endif
+#endif
+namespace trantor
+{
+class Channel;
+
+/**
+ * The poller backed by io_uring. The channels are watched with poll requests
+ * submitted to the ring, the requests made while handling events (new
+ * channels, interest changes and the re-arming of the fired one-shot polls)
+ * are submitted together by the io_uring_enter() call waiting for the next
+ * events, so changing the watched events costs no system call.
+ */
+class IoUringPoller : public Poller
+{
+  public:
+    explicit IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+    void poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+    PollerBackend backend() const override
+    {
+        return PollerBackend::IoUring;
+    }
+    // False if the kernel doesn't support the features used by the poller
+    bool valid() const
+    {
+        return ringFd_ >= 0;
+    }
+
+  private:
+    int ringFd_{-1};
+#ifdef USE_IO_URING
+    struct Entry
+    {
+        Channel *channel{nullptr};
+        // Bumped whenever the poll request of the channel is removed, the
+        // completions of the old requests are ignored
+        uint32_t generation{0};
+        bool armed{false};
+        bool dirty{false};
+        int armedEvents{0};
+    };
+    Entry &entry(int fd);
+    void markDirty(int fd);
+    void armDirtyChannels();
+    struct io_uring_sqe *getSqe();
+    int enter(unsigned toSubmit, unsigned minComplete, int timeoutMs);
+    void fillActiveChannels(ChannelList *activeChannels);
+
+    std::vector<Entry> entries_;
+    std::vector<int> dirtyFds_;
+
+    // The mapped rings
+    void *sqRing_{nullptr};
+    size_t sqRingSize_{0};
+    void *cqRing_{nullptr};
+    size_t cqRingSize_{0};
+    struct io_uring_sqe *sqes_{nullptr};
+    size_t sqesSize_{0};
+    unsigned *sqHead_{nullptr};
+    unsigned *sqTail_{nullptr};
+    unsigned sqMask_{0};
+    unsigned sqEntries_{0};
+    unsigned *sqArray_{nullptr};
+    unsigned *cqHead_{nullptr};
+    unsigned *cqTail_{nullptr};
+    unsigned cqMask_{0};
+    struct io_uring_cqe *cqes_{nullptr};
+    // The local tail of the submission queue and the number of entries not
+    // submitted yet
+    unsigned sqLocalTail_{0};
+    unsigned toSubmit_{0};
+#endif
+};
+}  // namespace trantor
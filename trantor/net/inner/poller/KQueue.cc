@@ -35,10 +35,10 @@ void KQueue::resetAfterFork()
     kqfd_ = kqueue();
     for (auto &ch : channels_)
     {
-        ch.second.first = 0;
-        if (ch.second.second->isReading() || ch.second.second->isWriting())
+        ch.first = 0;
+        if (ch.second && (ch.second->isReading() || ch.second->isWriting()))
         {
-            update(ch.second.second);
+            update(ch.second);
         }
     }
 }
@@ -61,10 +61,6 @@ void KQueue::poll(int timeoutMs, ChannelList *activeChannels)
     {
         // LOG_TRACE << numEvents << " events happended";
         fillActiveChannels(numEvents, activeChannels);
-        if (static_cast<size_t>(numEvents) == events_.size())
-        {
-            events_.resize(events_.size() * 2);
-        }
     }
     else if (numEvents == 0)
     {
@@ -79,6 +75,17 @@ void KQueue::poll(int timeoutMs, ChannelList *activeChannels)
             LOG_SYSERR << "KQueue::poll()";
         }
     }
+    if (numEvents >= 0)
+    {
+        recordPollEvents(static_cast<size_t>(numEvents));
+        size_t size =
+            nextEventBatchSize(events_.size(), static_cast<size_t>(numEvents));
+        if (size != events_.size())
+        {
+            events_.resize(size);
+            events_.shrink_to_fit();
+        }
+    }
     return;
 }
 
@@ -89,7 +96,7 @@ void KQueue::fillActiveChannels(int numEvents,
     for (int i = 0; i < numEvents; ++i)
     {
         Channel *channel = static_cast<Channel *>(events_[i].udata);
-        assert(channels_.find(channel->fd()) != channels_.end());
+        assert(hasChannel(channel->fd()));
         int events = events_[i].filter;
         if (events == EVFILT_READ)
         {
@@ -120,11 +127,11 @@ void KQueue::updateChannel(Channel *channel)
     {
         if (index == kNew)
         {
-            assert(channels_.find(channel->fd()) == channels_.end());
+            assert(!hasChannel(channel->fd()));
         }
         else
         {  // index == kDeleted
-            assert(channels_.find(channel->fd()) != channels_.end());
+            assert(hasChannel(channel->fd()));
             assert(channels_[channel->fd()].second == channel);
         }
         update(channel);
@@ -133,9 +140,7 @@ void KQueue::updateChannel(Channel *channel)
     else
     {
         // update existing one
-        int fd = channel->fd();
-        (void)fd;
-        assert(channels_.find(fd) != channels_.end());
+        assert(hasChannel(channel->fd()));
         assert(index == kAdded);
         if (channel->isNoneEvent())
         {
@@ -152,7 +157,7 @@ void KQueue::removeChannel(Channel *channel)
 {
     assertInLoopThread();
     int fd = channel->fd();
-    assert(channels_.find(fd) != channels_.end());
+    assert(hasChannel(fd));
     assert(channel->isNoneEvent());
     int index = channel->index();
     assert(index == kAdded || index == kDeleted);
@@ -162,9 +167,7 @@ void KQueue::removeChannel(Channel *channel)
         update(channel);
     }
 
-    size_t n = channels_.erase(fd);
-    (void)n;
-    assert(n == 1);
+    channels_[fd] = {0, nullptr};
     channel->setIndex(kNew);
 }
 
@@ -173,13 +176,10 @@ void KQueue::update(Channel *channel)
     struct kevent ev[2];
     int n = 0;
     auto events = channel->events();
-    int oldEvents = 0;
-    if (channels_.find(channel->fd()) != channels_.end())
-    {
-        oldEvents = channels_[channel->fd()].first;
-    }
-
     auto fd = channel->fd();
+    if (static_cast<size_t>(fd) >= channels_.size())
+        channels_.resize(fd + 1, {0, nullptr});
+    int oldEvents = channels_[fd].first;
     channels_[fd] = {events, channel};
 
     if ((events & Channel::kReadEvent) && (!(oldEvents & Channel::kReadEvent)))
@@ -225,6 +225,7 @@ void KQueue::update(Channel *channel)
                0,
                (void *)(intptr_t)channel);
     }
+    countInterestUpdate();
     kevent(kqfd_, ev, n, NULL, 0, NULL);
 }
 #else
@@ -21,7 +21,6 @@
     (defined(__APPLE__) && defined(__MACH__))
 #define USE_KQUEUE
 #include <memory>
-#include <unordered_map>
 #include <vector>
 using EventList = std::vector<struct kevent>;
 #endif
@@ -44,8 +43,14 @@ class KQueue : public Poller
     static const int kInitEventListSize = 16;
     int kqfd_;
     EventList events_;
-    using ChannelMap = std::unordered_map<int, std::pair<int, Channel *>>;
-    ChannelMap channels_;
+    // The watched events and the channel of each fd, indexed by fd
+    using ChannelTable = std::vector<std::pair<int, Channel *>>;
+    ChannelTable channels_;
+    bool hasChannel(int fd) const
+    {
+        return static_cast<size_t>(fd) < channels_.size() &&
+               channels_[fd].second != nullptr;
+    }
 
     void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
     void update(Channel *channel);
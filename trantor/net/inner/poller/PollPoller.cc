@@ -43,6 +43,8 @@ void PollPoller::poll(int timeoutMs, ChannelList* activeChannels)
     // XXX pollfds_ shouldn't change
     int numEvents = ::poll(pollfds_.data(), pollfds_.size(), timeoutMs);
     int savedErrno = errno;
+    if (numEvents >= 0)
+        recordPollEvents(static_cast<size_t>(numEvents));
     if (numEvents > 0)
     {
         // LOG_TRACE << numEvents << " events happened";
@@ -66,16 +68,14 @@ void PollPoller::fillActiveChannels(int numEvents,
                                     ChannelList* activeChannels) const
 {
     int processedEvents = 0;
-    for (auto pfd : pollfds_)
+    for (size_t i = 0; i < pollfds_.size(); ++i)
     {
+        const pollfd& pfd = pollfds_[i];
         if (pfd.revents > 0)
         {
-            auto ch = channels_.find(pfd.fd);
-            assert(ch != channels_.end());
-            Channel* channel = ch->second;
+            Channel* channel = pollChannels_[i];
             assert(channel->fd() == pfd.fd);
             channel->setRevents(pfd.revents);
-            // pfd.revents = 0;
             activeChannels->push_back(channel);
 
             processedEvents++;
@@ -93,36 +93,41 @@ void PollPoller::updateChannel(Channel* channel)
 
     // LOG_TRACE << "fd = " << channel->fd() << " events = " <<
     // channel->events();
-    if (channel->index() < 0)
+    size_t fd = static_cast<size_t>(channel->fd());
+    if (fd >= channels_.size())
+        channels_.resize(fd + 1, nullptr);
+    if (channels_[fd] == nullptr)
+    {
+        // a new one
+        assert(channel->index() < 0);
+        channels_[fd] = channel;
+    }
+    assert(channels_[fd] == channel);
+    int idx = channel->index();
+    if (channel->isNoneEvent())
+    {
+        // stop polling the fd
+        if (idx >= 0)
+            removePollfd(channel);
+    }
+    else if (idx < 0)
     {
-        // a new one, add to pollfds_
-        assert(channels_.find(channel->fd()) == channels_.end());
         pollfd pfd;
         pfd.fd = channel->fd();
         pfd.events = static_cast<short>(channel->events());
         pfd.revents = 0;
         pollfds_.push_back(pfd);
-        int idx = static_cast<int>(pollfds_.size()) - 1;
-        channel->setIndex(idx);
-        channels_[pfd.fd] = channel;
+        pollChannels_.push_back(channel);
+        channel->setIndex(static_cast<int>(pollfds_.size()) - 1);
     }
     else
     {
         // update existing one
-        assert(channels_.find(channel->fd()) != channels_.end());
-        assert(channels_[channel->fd()] == channel);
-        int idx = channel->index();
-        assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
+        assert(idx < static_cast<int>(pollfds_.size()));
         pollfd& pfd = pollfds_[idx];
-        assert(pfd.fd == channel->fd() || pfd.fd == -channel->fd() - 1);
-        pfd.fd = channel->fd();
+        assert(pfd.fd == channel->fd() && pollChannels_[idx] == channel);
         pfd.events = static_cast<short>(channel->events());
         pfd.revents = 0;
-        if (channel->isNoneEvent())
-        {
-            // ignore this pollfd
-            pfd.fd = -channel->fd() - 1;
-        }
     }
 }
 
@@ -130,32 +135,29 @@ void PollPoller::removeChannel(Channel* channel)
 {
     Poller::assertInLoopThread();
     // LOG_TRACE << "fd = " << channel->fd();
-    assert(channels_.find(channel->fd()) != channels_.end());
-    assert(channels_[channel->fd()] == channel);
+    size_t fd = static_cast<size_t>(channel->fd());
+    assert(fd < channels_.size() && channels_[fd] == channel);
     assert(channel->isNoneEvent());
+    if (channel->index() >= 0)
+        removePollfd(channel);
+    channels_[fd] = nullptr;
+}
+
+void PollPoller::removePollfd(Channel* channel)
+{
+    // Move the last pollfd into the hole to keep the array compact
     int idx = channel->index();
     assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
-    const pollfd& pfd = pollfds_[idx];
-    (void)pfd;
-    assert(pfd.fd == -channel->fd() - 1 && pfd.events == channel->events());
-    size_t n = channels_.erase(channel->fd());
-    assert(n == 1);
-    (void)n;
-    if (size_t(idx) == pollfds_.size() - 1)
-    {
-        pollfds_.pop_back();
-    }
-    else
+    assert(pollChannels_[idx] == channel);
+    if (size_t(idx) != pollfds_.size() - 1)
     {
-        int channelAtEnd = pollfds_.back().fd;
-        iter_swap(pollfds_.begin() + idx, pollfds_.end() - 1);
-        if (channelAtEnd < 0)
-        {
-            channelAtEnd = -channelAtEnd - 1;
-        }
-        channels_[channelAtEnd]->setIndex(idx);
-        pollfds_.pop_back();
+        pollfds_[idx] = pollfds_.back();
+        pollChannels_[idx] = pollChannels_.back();
+        pollChannels_[idx]->setIndex(idx);
     }
+    pollfds_.pop_back();
+    pollChannels_.pop_back();
+    channel->setIndex(-1);
 }
 #else
 PollPoller::PollPoller(EventLoop *loop) : Poller(loop)
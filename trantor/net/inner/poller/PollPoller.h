@@ -22,6 +22,11 @@
 
 namespace trantor
 {
+/**
+ * The poller backed by poll(). The pollfd array only holds the channels
+ * watching some events, the index of a channel is its position in the array
+ * (or -1), so adding, updating and removing a channel take constant time.
+ */
 class PollPoller : public Poller
 {
   public:
@@ -36,8 +41,12 @@ class PollPoller : public Poller
     void fillActiveChannels(int numEvents, ChannelList* activeChannels) const;
 
 #if defined __unix__ || defined __HAIKU__
+    void removePollfd(Channel* channel);
     std::vector<struct pollfd> pollfds_;
-    std::map<int, Channel*> channels_;
+    // The channels of the pollfds, in the same order
+    std::vector<Channel*> pollChannels_;
+    // The channels indexed by fd
+    std::vector<Channel*> channels_;
 #endif
 };
 
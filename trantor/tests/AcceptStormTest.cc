@@ -0,0 +1,78 @@
+#include <trantor/net/TcpServer.h>
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/utils/Logger.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+// Clients open connections as fast as they can and reset them right away, the
+// server only accepts them. Reports accepted connections per second for a
+// given accept batch size.
+static void runStorm(size_t maxAcceptsPerEvent)
+{
+    const int clients = 4;
+    const size_t connectionsPerClient = 5000;
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    TcpServer server(loop, InetAddress("127.0.0.1", 0), "storm");
+    server.setMaxAcceptsPerEvent(maxAcceptsPerEvent);
+    std::atomic<size_t> accepted{0};
+    server.setAfterAcceptSockOptCallback([&accepted](int) { ++accepted; });
+    server.start();
+    std::promise<uint16_t> port;
+    loop->runInLoop([&]() { port.set_value(server.address().toPort()); });
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port.get_future().get());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c)
+    {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < connectionsPerClient; ++i)
+            {
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+                {
+                    // RST instead of FIN, no TIME_WAIT on the client ports
+                    linger lg{1, 0};
+                    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+                }
+                close(fd);
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    const size_t total = clients * connectionsPerClient;
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (accepted < total && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(100us);
+    auto elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    std::cout << "max accepts per event " << maxAcceptsPerEvent
+              << ": accepted=" << accepted.load()
+              << " accepts/s=" << static_cast<size_t>(accepted / elapsed)
+              << std::endl;
+    server.stop();
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::kWarn);
+    runStorm(1);
+    runStorm(64);  // the default
+}
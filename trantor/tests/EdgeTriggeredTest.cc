@@ -0,0 +1,101 @@
+#include <trantor/net/TcpServer.h>
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/utils/Logger.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+using namespace trantor;
+
+// The client requests responses one after another, each response fills the
+// socket of the server, so the server waits for writability once per
+// response. Reports the throughput and the number of epoll_ctl() calls made
+// by the server in the level triggered and the edge triggered modes.
+static void runRequests(bool edgeTriggered, size_t responseSize)
+{
+    const size_t totalBytes = 1024UL * 1024 * 1024;
+    const size_t requests = totalBytes / responseSize;
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    TcpServer server(loop, InetAddress("127.0.0.1", 0), "requests");
+    auto response = std::make_shared<std::string>(responseSize, 'x');
+    uint64_t updatesBefore{0};
+    std::promise<void> connected;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setTcpNoDelay(true);
+        if (edgeTriggered)
+            conn->setEdgeTriggered(true);
+        updatesBefore = loop->pollerUpdates();
+        connected.set_value();
+    });
+    server.setRecvMessageCallback(
+        [&](const TcpConnectionPtr &conn, MsgBuffer *buffer) {
+            for (size_t i = 0; i < buffer->readableBytes(); ++i)
+                conn->send(response);
+            buffer->retrieveAll();
+        });
+    server.start();
+    std::promise<uint16_t> port;
+    loop->runInLoop([&]() { port.set_value(server.address().toPort()); });
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port.get_future().get());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        LOG_SYSERR << "connect";
+        close(fd);
+        return;
+    }
+    connected.get_future().wait();
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<char[]> buf(new char[64 * 1024]);
+    size_t received = 0;
+    for (size_t i = 0; i < requests; ++i)
+    {
+        if (write(fd, "r", 1) != 1)
+            break;
+        while (received < (i + 1) * responseSize)
+        {
+            auto n = read(fd, buf.get(), 64 * 1024);
+            if (n <= 0)
+                break;
+            received += n;
+        }
+    }
+    auto seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    std::promise<uint64_t> updates;
+    loop->runInLoop(
+        [&]() { updates.set_value(loop->pollerUpdates() - updatesBefore); });
+    std::cout << (edgeTriggered ? "edge " : "level") << " triggered, "
+              << responseSize / 1024 << " KB responses: " << requests
+              << " requests, " << received / seconds / 1024 / 1024
+              << " MB/s, " << updates.get_future().get() << " epoll_ctl calls"
+              << std::endl;
+    close(fd);
+    server.stop();
+}
+
+int main()
+{
+    for (size_t responseSize : {256 * 1024, 4 * 1024 * 1024})
+    {
+        runRequests(false, responseSize);
+        runRequests(true, responseSize);
+    }
+}
@@ -0,0 +1,94 @@
+#include <trantor/utils/LockFreeQueue.h>
+#include <trantor/net/EventLoop.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Count every heap allocation made by the process
+static std::atomic<uint64_t> allocations{0};
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// Producers push batches of tasks and, if batchSize is not zero, wait for the
+// consumer to catch up after each batch, as the loop does between polls.
+static void runBenchmark(const char *name, size_t batchSize)
+{
+    const int producers = 4;
+    const size_t itemsPerProducer = 1000000;
+    trantor::MpscQueue<trantor::LoopFunc> queue;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> executed{0};
+
+    auto allocsBefore = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&]() {
+        trantor::LoopFunc f;
+        while (!done.load(std::memory_order_acquire) || !queue.empty())
+        {
+            if (queue.dequeue(f))
+                f();
+            else
+                std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&]() {
+            auto conn = std::make_shared<int>(0);
+            auto msg = std::make_shared<std::string>("hello");
+            for (size_t i = 0; i < itemsPerProducer; ++i)
+            {
+                // Like a cross-thread send(), too large for the inline
+                // storage of std::function
+                queue.enqueue([&executed, conn, msg]() {
+                    executed.fetch_add(1, std::memory_order_relaxed);
+                });
+                auto n = submitted.fetch_add(1, std::memory_order_relaxed);
+                if (batchSize > 0 && (i + 1) % batchSize == 0)
+                {
+                    while (executed.load(std::memory_order_relaxed) <= n)
+                        std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    auto allocs = allocations.load() - allocsBefore;
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    const double total = double(producers) * itemsPerProducer;
+    std::cout << name << ": items=" << executed.load()
+              << " allocations/enqueue=" << allocs / total
+              << " ns/item=" << elapsed * 1000.0 / total << std::endl;
+}
+
+int main()
+{
+    runBenchmark("batches of 256", 256);
+    runBenchmark("unbounded flood", 0);
+}
@@ -0,0 +1,80 @@
+#include "LoopbackServer.h"
+#include <gtest/gtest.h>
+#include <future>
+#include <string>
+using namespace trantor;
+
+TEST(EventLoop, runAfterDispatch)
+{
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    std::promise<std::string> result;
+    loop->runInLoop([&]() {
+        auto order = std::make_shared<std::string>();
+        loop->runAfterDispatch([&, order]() {
+            *order += "c";
+            // Added by a running function, still run in this iteration
+            loop->runAfterDispatch(
+                [&, order]() { result.set_value(*order + "d"); });
+        });
+        loop->queueInLoop([order]() { *order += "b"; });
+        *order += "a";
+    });
+    EXPECT_EQ("abcd", result.get_future().get());
+}
+
+static void runServer(bool explicitFlush)
+{
+    constexpr size_t kMessages = 100;
+    test::LoopbackServer server("batch");
+    size_t sentBeforeFlush{0};
+    size_t sentAfterFlush{0};
+    std::promise<void> sent;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setBatchSend(true);
+        for (size_t i = 0; i < kMessages; ++i)
+            conn->send("message" + std::to_string(i) + "\n");
+        // Nothing is written until the end of the loop iteration
+        sentBeforeFlush = conn->bytesSent();
+        if (explicitFlush)
+        {
+            conn->flush();
+            sentAfterFlush = conn->bytesSent();
+        }
+        sent.set_value();
+    });
+    server.start();
+
+    int fd = server.connect();
+    ASSERT_GE(fd, 0);
+    std::string expected;
+    for (size_t i = 0; i < kMessages; ++i)
+        expected.append("message" + std::to_string(i) + "\n");
+    EXPECT_EQ(expected, test::readBytes(fd, expected.size()));
+    sent.get_future().wait();
+    EXPECT_EQ(0u, sentBeforeFlush);
+    if (explicitFlush)
+    {
+        EXPECT_EQ(expected.size(), sentAfterFlush);
+    }
+    close(fd);
+    server.stop();
+}
+
+TEST(BatchSend, flushAtIterationEnd)
+{
+    runServer(false);
+}
+TEST(BatchSend, explicitFlush)
+{
+    runServer(true);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
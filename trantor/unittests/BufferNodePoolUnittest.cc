@@ -0,0 +1,86 @@
+#include "LoopbackServer.h"
+#include <trantor/net/inner/MemBufferNodePool.h>
+#include <gtest/gtest.h>
+#include <future>
+#include <string>
+using namespace trantor;
+
+static void runRounds(size_t capacity)
+{
+    constexpr size_t kRounds = 4;
+    const std::string data(256 * 1024, 'x');
+    test::LoopbackServer server("pool");
+    auto serverLoop = server.loop();
+    serverLoop->setBufferNodePoolCapacity(capacity);
+    server.server().setAfterAcceptSockOptCallback([](int fd) {
+        int sndBuf = 16 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndBuf, sizeof(sndBuf));
+    });
+    std::promise<TcpConnectionPtr> connPromise;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+            connPromise.set_value(conn);
+    });
+    server.start();
+
+    int fd = server.connect();
+    ASSERT_GE(fd, 0);
+    auto conn = connPromise.get_future().get();
+    for (size_t i = 0; i < kRounds; ++i)
+    {
+        // Most of the data is left in a write buffer node, which is given
+        // back to the pool once the client has read everything.
+        conn->send(data);
+        ASSERT_EQ(data.size(), test::readBytes(fd, data.size()).size());
+        std::promise<void> flushed;
+        serverLoop->runInLoop([&]() { flushed.set_value(); });
+        flushed.get_future().wait();
+    }
+    if (capacity > 0)
+    {
+        EXPECT_EQ(1u, serverLoop->bufferNodePoolMisses());
+        EXPECT_EQ(kRounds - 1, serverLoop->bufferNodePoolHits());
+        EXPECT_EQ(1u, serverLoop->pooledBufferNodes());
+    }
+    else
+    {
+        EXPECT_EQ(kRounds, serverLoop->bufferNodePoolMisses());
+        EXPECT_EQ(0u, serverLoop->bufferNodePoolHits());
+        EXPECT_EQ(0u, serverLoop->pooledBufferNodes());
+    }
+    close(fd);
+    conn.reset();
+    server.stop();
+}
+
+TEST(BufferNodePool, reuseNodes)
+{
+    runRounds(16);
+}
+TEST(BufferNodePool, disabled)
+{
+    runRounds(0);
+}
+
+// Only the memory nodes are kept, emptied, by the pool
+TEST(BufferNodePool, memoryNodesOnly)
+{
+    MemBufferNodePool pool;
+    auto data = std::make_shared<std::string>("shared");
+    pool.recycle(
+        BufferNode::newSharedBufferNode(data, data->data(), data->size()));
+    EXPECT_EQ(0u, pool.size());
+    auto node = pool.get();
+    node->append("memory", 6);
+    pool.recycle(std::move(node));
+    EXPECT_EQ(1u, pool.size());
+    node = pool.get();
+    EXPECT_EQ(1u, pool.hits());
+    EXPECT_EQ(0, node->remainingBytes());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/net/Channel.h>
+#include <gtest/gtest.h>
+#include <future>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+using namespace trantor;
+
+// Channels ready in the same iteration are handled by priority
+TEST(ChannelPriority, handledInPriorityOrder)
+{
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    const ChannelPriority priorities[] = {ChannelPriority::Low,
+                                          ChannelPriority::Normal,
+                                          ChannelPriority::High,
+                                          ChannelPriority::Low,
+                                          ChannelPriority::High};
+    constexpr size_t kChannels = sizeof(priorities) / sizeof(priorities[0]);
+    int fds[kChannels][2];
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::vector<ChannelPriority> handled;
+    std::promise<void> done;
+    for (size_t i = 0; i < kChannels; ++i)
+    {
+        ASSERT_EQ(0, pipe(fds[i]));
+        channels.emplace_back(new Channel(loop, fds[i][0]));
+        auto channel = channels.back().get();
+        channel->setPriority(priorities[i]);
+        channel->setReadCallback([&, channel]() {
+            char c;
+            (void)::read(channel->fd(), &c, 1);
+            handled.push_back(channel->priority());
+            if (handled.size() == kChannels)
+                done.set_value();
+        });
+    }
+    // Make all pipes readable before the loop polls them
+    loop->runInLoop([&]() {
+        for (size_t i = 0; i < kChannels; ++i)
+        {
+            channels[i]->enableReading();
+            EXPECT_EQ(1, ::write(fds[i][1], "x", 1));
+        }
+    });
+    done.get_future().wait();
+    EXPECT_EQ((std::vector<ChannelPriority>{ChannelPriority::High,
+                                            ChannelPriority::High,
+                                            ChannelPriority::Normal,
+                                            ChannelPriority::Low,
+                                            ChannelPriority::Low}),
+              handled);
+    std::promise<void> removed;
+    loop->runInLoop([&]() {
+        for (auto &channel : channels)
+        {
+            channel->disableAll();
+            channel->remove();
+        }
+        removed.set_value();
+    });
+    removed.get_future().wait();
+    for (auto &fd : fds)
+    {
+        close(fd[0]);
+        close(fd[1]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
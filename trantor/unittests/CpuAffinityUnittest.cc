@@ -0,0 +1,71 @@
+#include <trantor/net/EventLoopThreadPool.h>
+#include <gtest/gtest.h>
+#include <future>
+#include <sched.h>
+#include <unistd.h>
+using namespace trantor;
+
+// The first CPU the process may run on, CPU 0 isn't always one of them in
+// containers or under taskset
+static int firstAllowedCpu()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed))
+            return cpu;
+    }
+    return -1;
+}
+
+TEST(CpuAffinity, numaAwareLayout)
+{
+    EventLoopThreadPool pool(2);
+    EXPECT_EQ(-1, pool.getLoopCpu(0));
+    ASSERT_TRUE(pool.setCpuAffinity());
+    pool.start();
+    for (size_t i = 0; i < pool.size(); ++i)
+    {
+        int cpu = pool.getLoopCpu(i);
+        ASSERT_GE(cpu, 0);
+        std::promise<int> current;
+        pool.getLoop(i)->runInLoop(
+            [&current]() { current.set_value(sched_getcpu()); });
+        EXPECT_EQ(cpu, current.get_future().get());
+    }
+    for (auto loop : pool.getLoops())
+        loop->quit();
+    pool.wait();
+}
+TEST(CpuAffinity, numaNode)
+{
+    if (access("/sys/devices/system/node/online", R_OK) != 0)
+    {
+        GTEST_SKIP() << "No NUMA layout on this host";
+    }
+    EventLoopThreadPool pool(2);
+    ASSERT_TRUE(pool.setCpuAffinity());
+    for (size_t i = 0; i < pool.size(); ++i)
+    {
+        EXPECT_GE(pool.getLoopNumaNode(i), 0);
+    }
+}
+TEST(CpuAffinity, explicitCpus)
+{
+    int cpu = firstAllowedCpu();
+    ASSERT_GE(cpu, 0);
+    EventLoopThreadPool pool(3);
+    ASSERT_TRUE(pool.setCpuAffinity({cpu}));
+    for (size_t i = 0; i < pool.size(); ++i)
+        EXPECT_EQ(cpu, pool.getLoopCpu(i));
+    EXPECT_EQ(-1, pool.getLoopCpu(3));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
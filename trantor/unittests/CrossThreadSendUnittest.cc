@@ -0,0 +1,94 @@
+#include "LoopbackServer.h"
+#include <gtest/gtest.h>
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace trantor;
+
+TEST(CrossThreadSend, orderPerThread)
+{
+    constexpr size_t kThreads = 4;
+    constexpr size_t kMessages = 2000;
+    // Larger than a pooled chunk
+    const std::string bigBody(10000, 'x');
+
+    test::LoopbackServer server("crossthread");
+    std::thread producer;
+    std::promise<void> started;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        producer = std::thread([&, conn]() {
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < kThreads; ++t)
+            {
+                threads.emplace_back([&, conn, t]() {
+                    for (size_t i = 0; i < kMessages; ++i)
+                    {
+                        auto line = std::to_string(t) + ":" +
+                                    std::to_string(i) + ":" +
+                                    (i % 100 == 0 ? bigBody : "") + "\n";
+                        switch (i % 3)
+                        {
+                            case 0:
+                                conn->send(line.data(), line.length());
+                                break;
+                            case 1:
+                                conn->send(line);
+                                break;
+                            default:
+                            {
+                                MsgBuffer buffer;
+                                buffer.append(line);
+                                conn->send(buffer);
+                                break;
+                            }
+                        }
+                    }
+                });
+            }
+            for (auto &thread : threads)
+                thread.join();
+            conn->shutdown();
+        });
+        started.set_value();
+    });
+    server.start();
+
+    int fd = server.connect();
+    ASSERT_GE(fd, 0);
+    // Until the server shuts the connection down
+    auto received = test::readBytes(fd);
+    started.get_future().wait();
+    producer.join();
+    close(fd);
+
+    // The messages of each thread arrive complete and in order
+    std::vector<size_t> next(kThreads, 0);
+    std::istringstream lines(received);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(lines, line))
+    {
+        auto first = line.find(':');
+        auto second = line.find(':', first + 1);
+        ASSERT_NE(std::string::npos, second);
+        auto t = std::stoul(line.substr(0, first));
+        auto i = std::stoul(line.substr(first + 1, second - first - 1));
+        ASSERT_LT(t, kThreads);
+        EXPECT_EQ(next[t], i);
+        EXPECT_EQ(i % 100 == 0 ? bigBody.size() : 0, line.size() - second - 1);
+        next[t] = i + 1;
+        ++count;
+    }
+    EXPECT_EQ(kThreads * kMessages, count);
+    server.stop();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,60 @@
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/net/Channel.h>
+#include <gtest/gtest.h>
+#include <future>
+#include <vector>
+#include <unistd.h>
+using namespace trantor;
+
+// The events changed several times between two polls are registered once
+TEST(DeferredUpdates, collapsedBetweenPolls)
+{
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    Channel channel(loop, fds[0]);
+    std::vector<uint64_t> updates;
+    uint64_t updatesBefore{0};
+    std::promise<void> done;
+    channel.setReadCallback([&]() {
+        char c;
+        (void)::read(fds[0], &c, 1);
+        updates.push_back(loop->pollerUpdates() - updatesBefore);
+        updatesBefore = loop->pollerUpdates();
+        if (updates.size() == 1)
+        {
+            // Back to the registered events before the next poll
+            channel.enableWriting();
+            channel.disableWriting();
+            EXPECT_EQ(1, ::write(fds[1], "x", 1));
+        }
+        else
+        {
+            channel.disableAll();
+            channel.remove();
+            updates.push_back(loop->pollerUpdates() - updatesBefore);
+            done.set_value();
+        }
+    });
+    loop->runInLoop([&]() {
+        updatesBefore = loop->pollerUpdates();
+        channel.enableReading();
+        channel.enableWriting();
+        channel.disableWriting();
+        EXPECT_EQ(1, ::write(fds[1], "x", 1));
+    });
+    done.get_future().wait();
+    // One epoll_ctl() to add the channel, none for the toggles, one to remove
+    // the channel
+    EXPECT_EQ((std::vector<uint64_t>{1, 0, 1}), updates);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
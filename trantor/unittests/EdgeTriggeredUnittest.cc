@@ -0,0 +1,121 @@
+#include "LoopbackServer.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <string>
+#include <netinet/tcp.h>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+static void setNoDelay(int fd)
+{
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+// The client requests chunks one after another, each chunk fills the socket of
+// the server. Returns the number of poller updates made while sending.
+static uint64_t sendChunks(bool edgeTriggered)
+{
+    constexpr size_t kChunks = 64;
+    constexpr size_t kChunkSize = 1024 * 1024;
+    test::LoopbackServer server("edge");
+    auto serverLoop = server.loop();
+    server.server().setAfterAcceptSockOptCallback([](int fd) {
+        int sndBuf = 64 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndBuf, sizeof(sndBuf));
+    });
+    size_t sentChunks{0};
+    uint64_t updatesBefore{0};
+    std::promise<void> connected;
+    std::promise<uint64_t> updates;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setTcpNoDelay(true);
+        if (edgeTriggered)
+            conn->setEdgeTriggered(true);
+        updatesBefore = serverLoop->pollerUpdates();
+        connected.set_value();
+    });
+    server.server().setRecvMessageCallback(
+        [&](const TcpConnectionPtr &conn, MsgBuffer *buffer) {
+            for (size_t i = 0; i < buffer->readableBytes(); ++i)
+            {
+                conn->send(std::string(
+                    kChunkSize, static_cast<char>('a' + sentChunks % 26)));
+                if (++sentChunks == kChunks)
+                    updates.set_value(serverLoop->pollerUpdates() -
+                                      updatesBefore);
+            }
+            buffer->retrieveAll();
+        });
+    server.start();
+
+    int fd = server.connect(setNoDelay);
+    EXPECT_GE(fd, 0);
+    connected.get_future().wait();
+    std::string received;
+    for (size_t i = 0; i < kChunks; ++i)
+    {
+        if (write(fd, "n", 1) != 1)
+            break;
+        received.append(test::readBytes(fd, kChunkSize));
+    }
+    EXPECT_EQ(kChunks * kChunkSize, received.size());
+    for (size_t i = 0; i < kChunks && i * kChunkSize < received.size(); ++i)
+    {
+        EXPECT_EQ(std::string(kChunkSize, static_cast<char>('a' + i % 26)),
+                  received.substr(i * kChunkSize, kChunkSize));
+    }
+    auto result = updates.get_future().get();
+    close(fd);
+    server.stop();
+    return result;
+}
+
+TEST(EdgeTriggered, writeWithoutPollerUpdates)
+{
+    auto levelUpdates = sendChunks(false);
+    auto edgeUpdates = sendChunks(true);
+    // Each chunk enables and disables writing in the level triggered mode
+    EXPECT_GT(levelUpdates, 64u);
+    EXPECT_LT(edgeUpdates, 4u);
+}
+
+TEST(EdgeTriggered, drainWithReadBudget)
+{
+    constexpr size_t kDataSize = 4 * 1024 * 1024;
+    test::LoopbackServer server("edge");
+    size_t received{0};
+    std::promise<void> done;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setEdgeTriggered(true);
+        // The data left in the socket when the budget is used up must be read
+        // without a new event
+        conn->setReadBudget(64 * 1024);
+    });
+    server.server().setRecvMessageCallback(
+        [&](const TcpConnectionPtr &, MsgBuffer *buffer) {
+            received += buffer->readableBytes();
+            buffer->retrieveAll();
+            if (received == kDataSize)
+                done.set_value();
+        });
+    server.start();
+
+    int fd = server.connect(setNoDelay);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(kDataSize, test::writeBytes(fd, std::string(kDataSize, 'x')));
+    EXPECT_EQ(std::future_status::ready, done.get_future().wait_for(10s));
+    close(fd);
+    server.stop();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
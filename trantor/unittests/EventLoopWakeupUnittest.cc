@@ -0,0 +1,110 @@
+#include <trantor/net/EventLoopThread.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+// Producers flood the loop, every queued function must run.
+TEST(EventLoopWakeup, floodLosesNothing)
+{
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    constexpr size_t kProducers = 8;
+    constexpr size_t kItemsPerProducer = 100000;
+    std::atomic<size_t> executed{0};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < kProducers; ++p)
+    {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < kItemsPerProducer; ++i)
+            {
+                loop->queueInLoop([&executed]() {
+                    executed.fetch_add(1, std::memory_order_relaxed);
+                });
+                if (i % 1000 == 0)
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (executed.load() < kProducers * kItemsPerProducer &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(kProducers * kItemsPerProducer, executed.load());
+}
+
+// Every function is queued while the loop is likely about to sleep, a lost
+// wakeup leaves the producer waiting until the poll timeout.
+TEST(EventLoopWakeup, pingPongLosesNothing)
+{
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    constexpr size_t kProducers = 4;
+    constexpr size_t kRounds = 5000;
+    std::atomic<size_t> lost{0};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < kProducers; ++p)
+    {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < kRounds; ++i)
+            {
+                auto done = std::make_shared<std::promise<void>>();
+                auto f = done->get_future();
+                loop->queueInLoop([done]() { done->set_value(); });
+                if (f.wait_for(2s) != std::future_status::ready)
+                {
+                    ++lost;
+                    f.wait();
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(0u, lost.load());
+}
+
+// With a spin time longer than the gap between two functions, the loop never
+// needs to block
+TEST(EventLoopWakeup, busyPollSpinHits)
+{
+    EventLoopThread loopThread;
+    auto loop = loopThread.getLoop();
+    loop->setBusyPollTime(100ms);
+    loopThread.run();
+    for (size_t i = 0; i < 100; ++i)
+    {
+        std::promise<void> done;
+        loop->queueInLoop([&done]() { done.set_value(); });
+        done.get_future().wait();
+    }
+    EXPECT_GT(loop->spinHits(), 0u);
+
+    // The counters keep counting after the busy poll mode is disabled
+    loop->setBusyPollTime(0us);
+    auto waits = loop->blockingWaits();
+    for (size_t i = 0; i < 100; ++i)
+    {
+        std::promise<void> done;
+        loop->queueInLoop([&done]() { done.set_value(); });
+        done.get_future().wait();
+        std::this_thread::sleep_for(100us);
+    }
+    EXPECT_GT(loop->blockingWaits(), waits);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
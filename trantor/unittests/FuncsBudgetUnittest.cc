@@ -0,0 +1,51 @@
+#include <trantor/net/EventLoopThreadPool.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+// A function queueing itself again must not starve the timers of the loop
+static void runBudgetTest(size_t maxCount, std::chrono::microseconds maxTime)
+{
+    EventLoopThreadPool pool(1);
+    pool.setFuncsBudget(maxCount, maxTime);
+    pool.start();
+    auto loop = pool.getLoop(0);
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> runs{0};
+    std::function<void()> spin;
+    spin = [&]() {
+        ++runs;
+        if (!stop)
+            loop->queueInLoop(spin);
+    };
+    std::promise<void> fired;
+    loop->runAfter(0.01, [&]() {
+        stop = true;
+        fired.set_value();
+    });
+    loop->queueInLoop(spin);
+    auto f = fired.get_future();
+    EXPECT_EQ(std::future_status::ready, f.wait_for(5s));
+    EXPECT_GT(runs.load(), 0u);
+    stop = true;
+    loop->runInLoop([loop]() { loop->quit(); });
+    pool.wait();
+}
+TEST(FuncsBudget, countBudget)
+{
+    runBudgetTest(64, 0us);
+}
+TEST(FuncsBudget, timeBudget)
+{
+    runBudgetTest(0, 200us);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+#include <trantor/net/EventLoopThreadPool.h>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+using namespace trantor;
+
+TEST(LoopSelector, roundRobin)
+{
+    EventLoopThreadPool pool(3);
+    auto loops = pool.getLoops();
+    for (size_t i = 0; i < 6; ++i)
+        EXPECT_EQ(loops[i % 3], pool.getNextLoop());
+}
+TEST(LoopSelector, leastConnections)
+{
+    EventLoopThreadPool pool(3);
+    pool.setLoopSelectPolicy(LoopSelectPolicy::LeastConnections);
+    auto loops = pool.getLoops();
+    loops[0]->updateConnectionStats(2, 0);
+    loops[2]->updateConnectionStats(1, 0);
+    for (size_t i = 0; i < 5; ++i)
+        EXPECT_EQ(loops[1], pool.getNextLoop());
+    loops[1]->updateConnectionStats(3, 0);
+    EXPECT_EQ(loops[2], pool.getNextLoop());
+    loops[0]->updateConnectionStats(-2, 0);
+    loops[1]->updateConnectionStats(-3, 0);
+    loops[2]->updateConnectionStats(-1, 0);
+}
+TEST(LoopSelector, leastPendingBytes)
+{
+    EventLoopThreadPool pool(3);
+    pool.setLoopSelectPolicy(LoopSelectPolicy::LeastPendingBytes);
+    auto loops = pool.getLoops();
+    loops[0]->updateConnectionStats(0, 1000);
+    loops[1]->updateConnectionStats(0, 10);
+    loops[2]->updateConnectionStats(0, 100);
+    EXPECT_EQ(loops[1], pool.getNextLoop());
+    EXPECT_EQ(loops[1], pool.getNextLoop());
+}
+TEST(LoopSelector, peerHash)
+{
+    EventLoopThreadPool pool(4);
+    pool.setLoopSelectPolicy(LoopSelectPolicy::PeerHash);
+    std::set<EventLoop *> used;
+    for (int i = 1; i < 64; ++i)
+    {
+        std::string ip = "10.0.0." + std::to_string(i);
+        auto loop = pool.getNextLoop(InetAddress(ip, 1000));
+        // Same IP, other port: same loop
+        EXPECT_EQ(loop, pool.getNextLoop(InetAddress(ip, 2000)));
+        used.insert(loop);
+    }
+    EXPECT_EQ(4u, used.size());
+    auto v6 = pool.getNextLoop(InetAddress("::1", 1000, true));
+    EXPECT_EQ(v6, pool.getNextLoop(InetAddress("::1", 2000, true)));
+}
+TEST(LoopSelector, customFunc)
+{
+    EventLoopThreadPool pool(3);
+    pool.setLoopSelectFunc(
+        [](const std::vector<EventLoop *> &, const InetAddress *peer) {
+            return peer ? size_t(2) : size_t(1);
+        });
+    auto loops = pool.getLoops();
+    EXPECT_EQ(loops[1], pool.getNextLoop());
+    EXPECT_EQ(loops[2], pool.getNextLoop(InetAddress("127.0.0.1", 80)));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <trantor/net/TcpServer.h>
+#include <trantor/net/EventLoopThread.h>
+#include <functional>
+#include <future>
+#include <limits>
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace trantor
+{
+namespace test
+{
+/**
+ * @brief A TcpServer listening on an ephemeral loopback port, run by its own
+ * event loop thread. The tests connect to it with plain sockets.
+ */
+class LoopbackServer : NonCopyable
+{
+  public:
+    explicit LoopbackServer(const std::string &name)
+        : loop_(startLoop(loopThread_)),
+          server_(loop_, InetAddress("127.0.0.1", 0), name)
+    {
+    }
+
+    EventLoop *loop() const
+    {
+        return loop_;
+    }
+    TcpServer &server()
+    {
+        return server_;
+    }
+
+    /**
+     * @brief Start the server, the callbacks must be set before.
+     */
+    void start()
+    {
+        server_.start();
+        std::promise<uint16_t> port;
+        loop_->runInLoop(
+            [&]() { port.set_value(server_.address().toPort()); });
+        port_ = port.get_future().get();
+    }
+    void stop()
+    {
+        server_.stop();
+    }
+
+    /**
+     * @brief Connect a client socket to the server.
+     *
+     * @param sockOptCallback Called with the socket before connecting.
+     * @return The socket, or -1 on failure.
+     */
+    int connect(const std::function<void(int)> &sockOptCallback = {}) const
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port_);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (sockOptCallback)
+            sockOptCallback(fd);
+        if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+  private:
+    static EventLoop *startLoop(EventLoopThread &loopThread)
+    {
+        loopThread.run();
+        return loopThread.getLoop();
+    }
+
+    EventLoopThread loopThread_;
+    EventLoop *loop_;
+    TcpServer server_;
+    uint16_t port_{0};
+};
+
+/**
+ * @brief Read from the socket until size bytes are received or the peer
+ * closes it.
+ */
+inline std::string readBytes(int fd,
+                             size_t size = std::numeric_limits<size_t>::max())
+{
+    std::string received;
+    char buf[65536];
+    while (received.size() < size)
+    {
+        auto n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        received.append(buf, n);
+    }
+    return received;
+}
+
+/**
+ * @brief Write all the data to the socket, returns the number of bytes
+ * written.
+ */
+inline size_t writeBytes(int fd, const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        auto n = ::write(fd, data.data() + written, data.size() - written);
+        if (n <= 0)
+            break;
+        written += n;
+    }
+    return written;
+}
+
+}  // namespace test
+}  // namespace trantor
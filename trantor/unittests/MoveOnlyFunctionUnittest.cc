@@ -0,0 +1,80 @@
+#include <trantor/utils/MoveOnlyFunction.h>
+#include <trantor/net/EventLoopThread.h>
+#include <gtest/gtest.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+using namespace trantor;
+TEST(MoveOnlyFunction, callAndMove)
+{
+    auto conn = std::make_shared<int>(1);
+    auto msg = std::make_shared<std::string>("abc");
+    std::string result;
+    MoveOnlyFunction<void()> f([conn, msg, &result]() { result = *msg; });
+    EXPECT_TRUE(static_cast<bool>(f));
+    EXPECT_EQ(2, conn.use_count());
+    MoveOnlyFunction<void()> g(std::move(f));
+    EXPECT_FALSE(static_cast<bool>(f));
+    g();
+    EXPECT_EQ("abc", result);
+    g = nullptr;
+    EXPECT_EQ(1, conn.use_count());
+    EXPECT_EQ(1, msg.use_count());
+}
+TEST(MoveOnlyFunction, moveOnlyCapture)
+{
+    std::unique_ptr<int> p(new int(42));
+    MoveOnlyFunction<int()> f([p = std::move(p)]() { return *p; });
+    MoveOnlyFunction<int()> g;
+    g = std::move(f);
+    EXPECT_EQ(42, g());
+}
+TEST(MoveOnlyFunction, largeCallable)
+{
+    char big[256] = {'x'};
+    auto conn = std::make_shared<int>(1);
+    MoveOnlyFunction<char(int)> f([big, conn](int i) { return big[i]; });
+    MoveOnlyFunction<char(int)> g(std::move(f));
+    EXPECT_EQ('x', g(0));
+    EXPECT_EQ(2, conn.use_count());
+    g = nullptr;
+    EXPECT_EQ(1, conn.use_count());
+}
+TEST(MoveOnlyFunction, fromStdFunction)
+{
+    int calls = 0;
+    std::function<void()> sf = [&calls]() { ++calls; };
+    MoveOnlyFunction<void()> f(sf);
+    f();
+    sf();
+    EXPECT_EQ(2, calls);
+    MoveOnlyFunction<void()> empty{std::function<void()>()};
+    EXPECT_FALSE(static_cast<bool>(empty));
+    EXPECT_THROW(empty(), std::bad_function_call);
+}
+// Func objects go through the overloads kept for binary compatibility, other
+// callables are wrapped into a LoopFunc
+TEST(MoveOnlyFunction, eventLoopOverloads)
+{
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    std::promise<int> done;
+    auto total = std::make_shared<int>(0);
+    const Func add = [total]() { ++*total; };
+    Func addAgain = add;
+    loop->queueInLoop(add);
+    loop->queueInLoop(std::move(addAgain));
+    loop->queueInLoop(LoopFunc(add));
+    auto owned = std::unique_ptr<int>(new int(1));
+    loop->queueInLoop([total, owned = std::move(owned), &done]() {
+        done.set_value(*total + *owned);
+    });
+    EXPECT_EQ(4, done.get_future().get());
+}
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
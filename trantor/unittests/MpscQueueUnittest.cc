@@ -0,0 +1,120 @@
+#include <trantor/utils/LockFreeQueue.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+using namespace trantor;
+TEST(MpscQueue, fifoAcrossSegments)
+{
+    MpscQueue<int> queue;
+    EXPECT_TRUE(queue.empty());
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 1000; ++i)
+            queue.enqueue(i);
+        int value;
+        for (int i = 0; i < 1000; ++i)
+        {
+            ASSERT_TRUE(queue.dequeue(value));
+            EXPECT_EQ(i, value);
+        }
+        EXPECT_FALSE(queue.dequeue(value));
+        EXPECT_TRUE(queue.empty());
+    }
+}
+TEST(MpscQueue, releasesItems)
+{
+    auto item = std::make_shared<int>(1);
+    {
+        MpscQueue<std::shared_ptr<int>> queue;
+        for (int i = 0; i < 100; ++i)
+            queue.enqueue(item);
+        std::shared_ptr<int> out;
+        for (int i = 0; i < 50; ++i)
+            ASSERT_TRUE(queue.dequeue(out));
+        out.reset();
+        EXPECT_EQ(51, item.use_count());
+    }
+    EXPECT_EQ(1, item.use_count());
+}
+TEST(MpscQueue, multipleProducers)
+{
+    const int producers = 4;
+    const int itemsPerProducer = 100000;
+    MpscQueue<std::pair<int, int>> queue;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, p]() {
+            for (int i = 0; i < itemsPerProducer; ++i)
+                queue.enqueue(std::make_pair(p, i));
+        });
+    }
+    std::vector<int> expected(producers, 0);
+    int received = 0;
+    std::pair<int, int> item;
+    while (received < producers * itemsPerProducer)
+    {
+        if (!queue.dequeue(item))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        // Items of one producer keep their order
+        ASSERT_EQ(expected[item.first], item.second);
+        ++expected[item.first];
+        ++received;
+    }
+    for (auto &t : threads)
+        t.join();
+    EXPECT_TRUE(queue.empty());
+}
+struct ThrowingItem
+{
+    ThrowingItem() = default;
+    explicit ThrowingItem(int v) : value(v)
+    {
+    }
+    ThrowingItem(const ThrowingItem &other) : value(other.value)
+    {
+        if (value < 0)
+            throw std::runtime_error("copy");
+    }
+    ThrowingItem &operator=(const ThrowingItem &) = default;
+    int value{0};
+};
+TEST(MpscQueue, throwingConstructor)
+{
+    MpscQueue<ThrowingItem> queue;
+    // Some of the failed items take the last slot of a segment
+    for (int i = 0; i < 100; ++i)
+    {
+        ThrowingItem item(i % 3 == 0 ? -1 : i);
+        if (i % 3 == 0)
+            EXPECT_THROW(queue.enqueue(item), std::runtime_error);
+        else
+            queue.enqueue(item);
+    }
+    ThrowingItem item;
+    for (int i = 0; i < 100; ++i)
+    {
+        if (i % 3 == 0)
+            continue;
+        ASSERT_TRUE(queue.dequeue(item));
+        EXPECT_EQ(i, item.value);
+    }
+    EXPECT_FALSE(queue.dequeue(item));
+    // Abandoned slots at the head don't count as items
+    EXPECT_THROW(queue.enqueue(ThrowingItem(-1)), std::runtime_error);
+    EXPECT_TRUE(queue.empty());
+    queue.enqueue(ThrowingItem(1));
+    EXPECT_FALSE(queue.empty());
+    ASSERT_TRUE(queue.dequeue(item));
+    EXPECT_EQ(1, item.value);
+}
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -2,6 +2,10 @@
 #include <gtest/gtest.h>
 #include <string>
 #include <iostream>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 using namespace trantor;
 TEST(MsgBufferTest, readableTest)
 {
@@ -71,6 +75,57 @@ TEST(Msgbuffer, MoveAssignmentOperator)
     EXPECT_EQ(bufptr, buffnew.peek());
     EXPECT_EQ(writable, buffnew.writableBytes());
 }
+#ifndef _WIN32
+TEST(MsgBufferTest, readFdQueryAvailable)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    std::string data(100000, 'a');
+    ASSERT_EQ((ssize_t)data.size(), write(fds[0], data.data(), data.size()));
+    MsgBuffer buffer;
+    int err = 0;
+    // The whole pending data is read at once
+    EXPECT_EQ((ssize_t)data.size(), buffer.readFd(fds[1], &err, true));
+    EXPECT_EQ(data, std::string(buffer.peek(), buffer.readableBytes()));
+    close(fds[0]);
+    close(fds[1]);
+}
+TEST(MsgBufferTest, readFdAdaptsToReadSize)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    std::string data(32 * 1024, 'b');
+    MsgBuffer buffer;
+    int err = 0;
+    const char *lastPtr = nullptr;
+    for (int i = 0; i < 20; ++i)
+    {
+        ASSERT_EQ((ssize_t)data.size(),
+                  write(fds[0], data.data(), data.size()));
+        int reads = 0;
+        while (buffer.readableBytes() < data.size())
+        {
+            ASSERT_GT(buffer.readFd(fds[1], &err), 0);
+            ++reads;
+        }
+        if (i >= 15)
+        {
+            // Once the buffer has adapted, each burst is read at once into the
+            // same memory
+            EXPECT_EQ(1, reads);
+            if (lastPtr)
+            {
+                EXPECT_EQ(lastPtr, buffer.peek());
+            }
+        }
+        lastPtr = buffer.peek();
+        buffer.retrieveAll();
+        EXPECT_GE(buffer.writableBytes(), data.size());
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+#endif
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,106 @@
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/net/Channel.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+using namespace trantor;
+
+// The events ready at once are fetched in batches of the maximum size
+TEST(PollEvents, batchesBoundedByMaxSize)
+{
+    constexpr size_t kChannels = 64;
+    constexpr size_t kMaxBatch = 16;
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    loop->setPollEventsBatchSize(4, kMaxBatch);
+    int fds[kChannels][2];
+    std::vector<std::unique_ptr<Channel>> channels;
+    size_t handled{0};
+    std::promise<void> done;
+    for (size_t i = 0; i < kChannels; ++i)
+    {
+        ASSERT_EQ(0, pipe(fds[i]));
+        channels.emplace_back(new Channel(loop, fds[i][0]));
+        auto channel = channels.back().get();
+        channel->setReadCallback([&, channel]() {
+            char c;
+            (void)::read(channel->fd(), &c, 1);
+            if (++handled == kChannels)
+                done.set_value();
+        });
+    }
+    PollEventsHistogram before;
+    uint64_t saturatedBefore{0};
+    loop->runInLoop([&]() {
+        before = loop->pollEventsHistogram();
+        saturatedBefore = loop->saturatedPolls();
+        for (size_t i = 0; i < kChannels; ++i)
+        {
+            channels[i]->enableReading();
+            EXPECT_EQ(1, ::write(fds[i][1], "x", 1));
+        }
+    });
+    done.get_future().wait();
+    std::promise<void> removed;
+    PollEventsHistogram after;
+    uint64_t saturatedAfter{0};
+    loop->runInLoop([&]() {
+        after = loop->pollEventsHistogram();
+        saturatedAfter = loop->saturatedPolls();
+        for (auto &channel : channels)
+        {
+            channel->disableAll();
+            channel->remove();
+        }
+        removed.set_value();
+    });
+    removed.get_future().wait();
+    for (auto &fd : fds)
+    {
+        close(fd[0]);
+        close(fd[1]);
+    }
+
+    // Bucket 5 counts 16 to 31 events, no iteration handled more
+    for (size_t i = 6; i < kPollEventsBuckets; ++i)
+    {
+        EXPECT_EQ(before[i], after[i]) << "bucket " << i;
+    }
+    EXPECT_GE(after[5] - before[5], kChannels / kMaxBatch - 1);
+    EXPECT_GE(saturatedAfter - saturatedBefore, kChannels / kMaxBatch - 1);
+}
+
+// The empty polls made while spinning in the busy poll mode are not counted
+TEST(PollEvents, spinPollsNotCounted)
+{
+    EventLoopThread loopThread;
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    loop->setBusyPollTime(std::chrono::milliseconds(2));
+    std::promise<PollEventsHistogram> before;
+    loop->runInLoop([&]() { before.set_value(loop->pollEventsHistogram()); });
+    auto emptyBefore = before.get_future().get()[0];
+    auto blockingWaitsBefore = loop->blockingWaits();
+    // Each wakeup is followed by spinning until the next one
+    for (int i = 0; i < 10; ++i)
+    {
+        loop->queueInLoop([]() {});
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    }
+    std::promise<PollEventsHistogram> after;
+    loop->runInLoop([&]() { after.set_value(loop->pollEventsHistogram()); });
+    EXPECT_LT(after.get_future().get()[0], emptyBefore + 10);
+    // The spinning ended in blocking waits, which are counted
+    EXPECT_GT(loop->blockingWaits(), blockingWaitsBefore);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
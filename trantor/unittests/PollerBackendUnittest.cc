@@ -0,0 +1,125 @@
+#include "LoopbackServer.h"
+#include <trantor/net/Channel.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+// Echo a few MB on several connections at once, so reads, writes under
+// backpressure and interest changes all go through the poller.
+static void runEcho(PollerBackend backend)
+{
+    constexpr size_t kClients = 4;
+    constexpr size_t kDataSize = 2 * 1024 * 1024;
+    EventLoop::setPollerBackend(backend);
+    test::LoopbackServer server("echo");
+    EventLoop::setPollerBackend(PollerBackend::Default);
+    auto serverLoop = server.loop();
+    if (backend == PollerBackend::IoUring &&
+        serverLoop->pollerBackend() != PollerBackend::IoUring)
+    {
+        std::cout << "io_uring is not available, testing the fallback"
+                  << std::endl;
+    }
+    else
+    {
+        EXPECT_EQ(backend, serverLoop->pollerBackend());
+    }
+
+    server.server().setRecvMessageCallback(
+        [](const TcpConnectionPtr &conn, MsgBuffer *buffer) {
+            conn->send(buffer->peek(), buffer->readableBytes());
+            buffer->retrieveAll();
+        });
+    server.start();
+
+    std::promise<void> timerFired;
+    serverLoop->runAfter(0.01, [&]() { timerFired.set_value(); });
+
+    std::vector<std::thread> clients;
+    std::vector<size_t> echoed(kClients, 0);
+    for (size_t i = 0; i < kClients; ++i)
+    {
+        clients.emplace_back([&, i]() {
+            int fd = server.connect();
+            if (fd < 0)
+                return;
+            std::string data(kDataSize, static_cast<char>('a' + i));
+            std::thread writer([&]() { test::writeBytes(fd, data); });
+            auto received = test::readBytes(fd, kDataSize);
+            writer.join();
+            if (received == data)
+                echoed[i] = received.size();
+            close(fd);
+        });
+    }
+    for (auto &t : clients)
+        t.join();
+    for (size_t i = 0; i < kClients; ++i)
+        EXPECT_EQ(kDataSize, echoed[i]);
+    EXPECT_EQ(std::future_status::ready,
+              timerFired.get_future().wait_for(5s));
+    server.stop();
+}
+
+TEST(PollerBackend, epoll)
+{
+    runEcho(PollerBackend::Default);
+}
+TEST(PollerBackend, ioUring)
+{
+    runEcho(PollerBackend::IoUring);
+}
+
+// A failed poll request is reported to the channel once, not retried
+TEST(PollerBackend, ioUringFailedPoll)
+{
+    EventLoop::setPollerBackend(PollerBackend::IoUring);
+    EventLoopThread loopThread;
+    EventLoop::setPollerBackend(PollerBackend::Default);
+    loopThread.run();
+    auto loop = loopThread.getLoop();
+    if (loop->pollerBackend() != PollerBackend::IoUring)
+    {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    Channel channel(loop, fds[0]);
+    std::atomic<int> errors{0};
+    channel.setErrorCallback([&]() { ++errors; });
+    loop->runInLoop([&]() {
+        channel.enableReading();
+        // Closed before the next poll submits the request
+        close(fds[0]);
+    });
+    for (int i = 0; i < 10; ++i)
+    {
+        // Lets the loop go back to polling between the functions
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::promise<void> polled;
+        loop->queueInLoop([&]() { polled.set_value(); });
+        polled.get_future().wait();
+    }
+    std::promise<void> removed;
+    loop->runInLoop([&]() {
+        channel.disableAll();
+        channel.remove();
+        removed.set_value();
+    });
+    removed.get_future().wait();
+    close(fds[1]);
+    EXPECT_EQ(1, errors.load());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
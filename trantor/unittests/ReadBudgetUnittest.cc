@@ -0,0 +1,90 @@
+#include "LoopbackServer.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+using namespace trantor;
+
+struct ReadStats
+{
+    size_t maxReadsPerEvent{0};
+    size_t maxBytesBeforeLastRead{0};
+};
+
+static ReadStats receive(size_t budget)
+{
+    constexpr size_t kDataSize = 4 * 1024 * 1024;
+    test::LoopbackServer server("budget");
+    auto serverLoop = server.loop();
+    ReadStats stats;
+    size_t received{0};
+    size_t reads{0};
+    size_t bytes{0};
+    size_t lastRead{0};
+    std::promise<void> done;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setReadBudget(budget);
+        // Let the data pile up in the socket
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    server.server().setRecvMessageCallback(
+        [&](const TcpConnectionPtr &, MsgBuffer *buffer) {
+            // The reads of one readiness event are counted until the end of
+            // the loop iteration
+            if (reads == 0)
+            {
+                serverLoop->runAfterDispatch([&]() {
+                    stats.maxReadsPerEvent =
+                        (std::max)(stats.maxReadsPerEvent, reads);
+                    stats.maxBytesBeforeLastRead =
+                        (std::max)(stats.maxBytesBeforeLastRead,
+                                   bytes - lastRead);
+                    reads = 0;
+                    bytes = 0;
+                });
+            }
+            ++reads;
+            lastRead = buffer->readableBytes();
+            bytes += lastRead;
+            received += lastRead;
+            buffer->retrieveAll();
+            if (received == kDataSize)
+                done.set_value();
+        });
+    server.start();
+
+    int fd = server.connect();
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(kDataSize, test::writeBytes(fd, std::string(kDataSize, 'x')));
+    done.get_future().wait();
+    // Read the statistics after the last loop iteration
+    std::promise<void> synced;
+    serverLoop->queueInLoop([&]() { synced.set_value(); });
+    synced.get_future().wait();
+    close(fd);
+    server.stop();
+    return stats;
+}
+
+TEST(ReadBudget, oneReadPerEvent)
+{
+    auto stats = receive(0);
+    EXPECT_EQ(1u, stats.maxReadsPerEvent);
+}
+TEST(ReadBudget, drainUpToBudget)
+{
+    constexpr size_t kBudget = 256 * 1024;
+    auto stats = receive(kBudget);
+    EXPECT_GT(stats.maxReadsPerEvent, 1u);
+    // The last read of an event starts before the budget is used up
+    EXPECT_LT(stats.maxBytesBeforeLastRead, kBudget);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+#include "LoopbackServer.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+// start() returns before the I/O loops listen
+static int connectWhenListening(const test::LoopbackServer &server)
+{
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    int fd = server.connect();
+    while (fd < 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+        fd = server.connect();
+    }
+    return fd;
+}
+
+static void runServer(bool cpuFilter)
+{
+    test::LoopbackServer server("reuseport");
+    auto serverLoop = server.loop();
+    server.server().setIoLoopNum(2);
+    server.server().enableReusePortAcceptors(cpuFilter);
+    std::mutex mutex;
+    std::set<EventLoop *> connLoops;
+    std::atomic<size_t> connected{0};
+    std::atomic<size_t> closed{0};
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            // Accepted and established in the same I/O loop
+            EXPECT_TRUE(conn->getLoop()->isInLoopThread());
+            EXPECT_NE(serverLoop, conn->getLoop());
+            std::lock_guard<std::mutex> lock(mutex);
+            connLoops.insert(conn->getLoop());
+            ++connected;
+        }
+        else
+        {
+            ++closed;
+        }
+    });
+    server.start();
+
+    constexpr size_t kClients = 64;
+    std::vector<int> fds;
+    for (size_t i = 0; i < kClients; ++i)
+    {
+        int fd = connectWhenListening(server);
+        ASSERT_GE(fd, 0);
+        fds.push_back(fd);
+    }
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (connected < kClients && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(kClients, connected.load());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_GE(connLoops.size(), 1u);
+    }
+    for (int fd : fds)
+        close(fd);
+    deadline = std::chrono::steady_clock::now() + 5s;
+    while (closed < kClients && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(kClients, closed.load());
+    server.stop();
+}
+
+TEST(ReusePortAcceptors, acceptInIoLoops)
+{
+    runServer(false);
+}
+TEST(ReusePortAcceptors, cpuFilter)
+{
+    runServer(true);
+}
+
+// The server loop doesn't wait for I/O loops which don't run yet
+TEST(ReusePortAcceptors, ioLoopsStartedLater)
+{
+    EventLoopThread ioLoopThread;
+    auto ioLoop = ioLoopThread.getLoop();
+    test::LoopbackServer server("reuseport");
+    server.server().setIoLoops({ioLoop});
+    server.server().enableReusePortAcceptors();
+    std::promise<EventLoop *> connLoop;
+    std::promise<void> closed;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+            connLoop.set_value(conn->getLoop());
+        else
+            closed.set_value();
+    });
+    server.start();
+
+    ioLoopThread.run();
+    int fd = connectWhenListening(server);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(ioLoop, connLoop.get_future().get());
+    close(fd);
+    // The I/O loop outlives the server, the connection must be gone before
+    // the server is destroyed
+    closed.get_future().wait();
+    server.stop();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+#include <trantor/utils/SegmentedBuffer.h>
+#include <gtest/gtest.h>
+#include <string>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+using namespace trantor;
+
+static std::string pattern(size_t len)
+{
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+    return data;
+}
+static std::string contents(const SegmentedBuffer &buffer)
+{
+    const char *data[64];
+    size_t len[64];
+    auto count = buffer.getSegments(data, len, 64);
+    std::string ret;
+    for (size_t i = 0; i < count; ++i)
+        ret.append(data[i], len[i]);
+    return ret;
+}
+
+TEST(SegmentedBufferTest, appendAndRetrieve)
+{
+    SegmentedBuffer buffer(4096);
+    EXPECT_EQ(0u, buffer.readableBytes());
+    EXPECT_EQ(0u, buffer.segmentCount());
+    auto data = pattern(10000);
+    buffer.append(data.data(), 100);
+    EXPECT_EQ(1u, buffer.segmentCount());
+    buffer.append(data.data() + 100, data.size() - 100);
+    EXPECT_EQ(data.size(), buffer.readableBytes());
+    // 2048 + 4096 + 4096 bytes blocks
+    EXPECT_EQ(3u, buffer.segmentCount());
+    EXPECT_EQ(data, contents(buffer));
+
+    buffer.retrieve(3000);
+    EXPECT_EQ(data.substr(3000), contents(buffer));
+    EXPECT_EQ(2u, buffer.segmentCount());
+    const char *seg;
+    size_t len;
+    buffer.peekSegment(seg, len);
+    EXPECT_EQ(data.substr(3000, len), std::string(seg, len));
+
+    buffer.retrieveAll();
+    EXPECT_EQ(0u, buffer.readableBytes());
+    EXPECT_EQ("", contents(buffer));
+    buffer.append("abc", 3);
+    EXPECT_EQ("abc", contents(buffer));
+}
+
+TEST(SegmentedBufferTest, linearize)
+{
+    SegmentedBuffer buffer(1024);
+    EXPECT_EQ(nullptr, buffer.linearize());
+    auto data = pattern(5000);
+    buffer.append(data);
+    EXPECT_GT(buffer.segmentCount(), 1u);
+    auto view = buffer.linearize();
+    EXPECT_EQ(1u, buffer.segmentCount());
+    EXPECT_EQ(data, std::string(view, buffer.readableBytes()));
+    buffer.append("tail", 4);
+    EXPECT_EQ(data + "tail", contents(buffer));
+}
+
+TEST(SegmentedBufferTest, addInFront)
+{
+    SegmentedBuffer buffer;
+    buffer.addInFront("body", 4);
+    EXPECT_EQ("body", contents(buffer));
+    buffer.retrieve(2);
+    // There is room in front of the data now
+    buffer.addInFront("xx", 2);
+    EXPECT_EQ(1u, buffer.segmentCount());
+    buffer.addInFront("header:", 7);
+    EXPECT_EQ("header:xxdy", contents(buffer));
+}
+
+#ifndef _WIN32
+TEST(SegmentedBufferTest, readAndWriteFd)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    auto data = pattern(40000);
+    SegmentedBuffer out(8192);
+    out.append(data);
+    int err = 0;
+    size_t written = 0;
+    while (out.readableBytes() > 0)
+    {
+        auto n = out.writeFd(fds[0], &err);
+        ASSERT_GT(n, 0);
+        written += n;
+    }
+    EXPECT_EQ(data.size(), written);
+
+    SegmentedBuffer in(8192);
+    in.append("prefix", 6);
+    while (in.readableBytes() < data.size() + 6)
+    {
+        auto n = in.readFd(fds[1], &err);
+        ASSERT_GT(n, 0);
+    }
+    EXPECT_GT(in.segmentCount(), 1u);
+    EXPECT_EQ("prefix" + data, contents(in));
+    close(fds[0]);
+    close(fds[1]);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
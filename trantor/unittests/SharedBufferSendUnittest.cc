@@ -0,0 +1,186 @@
+#include "LoopbackServer.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+static std::string expectedStream(const std::string &payload, size_t rounds)
+{
+    std::string expected;
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        expected.append(payload);
+        expected.append("#" + std::to_string(i) + "\n");
+    }
+    return expected;
+}
+
+TEST(SharedBufferSend, broadcastInOrder)
+{
+    constexpr size_t kClients = 4;
+    constexpr size_t kRounds = 32;
+    std::string data(64 * 1024, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+    auto payload = std::make_shared<std::string>(data);
+    auto bufPayload = std::make_shared<MsgBuffer>();
+    bufPayload->append(data);
+
+    test::LoopbackServer server("shared");
+    // Small kernel buffers to keep most of the data in the write buffer list
+    server.server().setAfterAcceptSockOptCallback([](int fd) {
+        int sndBuf = 16 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndBuf, sizeof(sndBuf));
+    });
+    std::atomic<size_t> sentConns{0};
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        // The clients don't read yet, so the payloads are queued, interleaved
+        // with copied messages.
+        for (size_t i = 0; i < kRounds; ++i)
+        {
+            if (i % 2 == 0)
+                conn->send(payload);
+            else
+                conn->send(bufPayload);
+            conn->send("#" + std::to_string(i) + "\n");
+        }
+        ++sentConns;
+    });
+    server.start();
+
+    std::vector<int> fds;
+    for (size_t i = 0; i < kClients; ++i)
+    {
+        int fd = server.connect([](int sock) {
+            int rcvBuf = 4096;
+            setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+        });
+        ASSERT_GE(fd, 0);
+        fds.push_back(fd);
+    }
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (sentConns < kClients && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_EQ(kClients, sentConns.load());
+
+    // The unsent data still references the shared payloads instead of copies
+    std::promise<long> useCount;
+    server.loop()->runInLoop([&]() { useCount.set_value(payload.use_count()); });
+    EXPECT_GT(useCount.get_future().get(), 1);
+
+    auto expected = expectedStream(data, kRounds);
+    for (int fd : fds)
+    {
+        EXPECT_TRUE(test::readBytes(fd, expected.size()) == expected);
+        close(fd);
+    }
+
+    // Every node is released once its data is sent
+    deadline = std::chrono::steady_clock::now() + 5s;
+    while ((payload.use_count() > 1 || bufPayload.use_count() > 1) &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(1, payload.use_count());
+    EXPECT_EQ(1, bufPayload.use_count());
+    EXPECT_EQ(data.size(), bufPayload->readableBytes());
+    server.stop();
+}
+
+TEST(SharedBufferSend, vectoredInOrder)
+{
+    constexpr size_t kRounds = 64;
+    auto body = std::make_shared<std::string>(32 * 1024, 'b');
+    auto empty = std::make_shared<std::string>();
+
+    test::LoopbackServer server("vectored");
+    server.server().setAfterAcceptSockOptCallback([](int fd) {
+        int sndBuf = 16 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndBuf, sizeof(sndBuf));
+    });
+    std::atomic<bool> sent{false};
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        // Sent from another thread, the first rounds are written directly
+        // and the rest are queued
+        auto sender = [conn, body, empty]() {
+            for (size_t i = 0; i < kRounds; ++i)
+            {
+                auto header =
+                    std::make_shared<std::string>(std::to_string(i) + ":");
+                conn->send({header, empty, body});
+                conn->send("|");
+            }
+        };
+        std::thread(sender).join();
+        sent = true;
+    });
+    server.start();
+
+    int fd = server.connect();
+    ASSERT_GE(fd, 0);
+    std::string expected;
+    for (size_t i = 0; i < kRounds; ++i)
+    {
+        expected.append(std::to_string(i) + ":");
+        expected.append(*body);
+        expected.append("|");
+    }
+    auto received = test::readBytes(fd, expected.size());
+    EXPECT_TRUE(sent);
+    EXPECT_TRUE(received == expected);
+    close(fd);
+    server.stop();
+}
+
+// More buffers than one writev() takes, all written before the socket fills up
+TEST(SharedBufferSend, vectoredBeyondIovMax)
+{
+    constexpr size_t kBuffers = 3000;
+    std::vector<std::shared_ptr<std::string>> buffers;
+    std::string expected;
+    for (size_t i = 0; i < kBuffers; ++i)
+    {
+        buffers.push_back(
+            std::make_shared<std::string>(std::to_string(i) + ","));
+        expected.append(*buffers.back());
+    }
+
+    test::LoopbackServer server("vectored");
+    std::promise<TcpConnectionPtr> connPromise;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setEdgeTriggered(true);
+        connPromise.set_value(conn);
+    });
+    server.start();
+
+    int fd = server.connect([](int sock) {
+        timeval timeout{5, 0};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    });
+    ASSERT_GE(fd, 0);
+    auto conn = connPromise.get_future().get();
+    // Sent long after the writability edge of the new socket, no other edge
+    // comes for a socket that never fills up
+    std::this_thread::sleep_for(50ms);
+    conn->send(buffers);
+    EXPECT_TRUE(test::readBytes(fd, expected.size()) == expected);
+    close(fd);
+    conn.reset();
+    server.stop();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,132 @@
+#include "LoopbackServer.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+using namespace trantor;
+using namespace std::chrono_literals;
+
+TEST(ZeroCopySend, largePayloads)
+{
+    constexpr size_t kRounds = 16;
+    std::string data(1024 * 1024, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+    auto payload = std::make_shared<std::string>(data);
+    auto smallPayload = std::make_shared<std::string>("small\n");
+
+    test::LoopbackServer server("zerocopy");
+    std::atomic<bool> sent{false};
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setZeroCopyThreshold(64 * 1024);
+        for (size_t i = 0; i < kRounds; ++i)
+        {
+            conn->send(payload);
+            // Below the threshold, sent the usual way
+            conn->send(smallPayload);
+        }
+        sent = true;
+    });
+    server.start();
+
+    int fd = server.connect();
+    ASSERT_GE(fd, 0);
+    std::string expected;
+    for (size_t i = 0; i < kRounds; ++i)
+    {
+        expected.append(data);
+        expected.append(*smallPayload);
+    }
+    auto received = test::readBytes(fd, expected.size());
+    EXPECT_TRUE(sent);
+    EXPECT_TRUE(received == expected);
+
+    // The payload is released once the kernel reports the completions
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (payload.use_count() > 1 &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(1, payload.use_count());
+    close(fd);
+    server.stop();
+}
+
+// The connection is half-closed once the kernel has released the buffers
+TEST(ZeroCopySend, shutdownAfterSend)
+{
+    std::string data(4 * 1024 * 1024, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+    auto payload = std::make_shared<std::string>(data);
+
+    test::LoopbackServer server("zerocopy");
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+            return;
+        conn->setZeroCopyThreshold(64 * 1024);
+        conn->send(payload);
+        conn->shutdown();
+    });
+    server.start();
+
+    int fd = server.connect();
+    ASSERT_GE(fd, 0);
+    // Until the end of the stream
+    EXPECT_TRUE(test::readBytes(fd) == data);
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (payload.use_count() > 1 &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(1, payload.use_count());
+    close(fd);
+    server.stop();
+}
+
+// The buffers handed to the kernel outlive the connection
+TEST(ZeroCopySend, forceCloseAfterSend)
+{
+    std::string data(4 * 1024 * 1024, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+    auto payload = std::make_shared<std::string>(data);
+
+    test::LoopbackServer server("zerocopy");
+    std::promise<void> closed;
+    server.server().setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+        {
+            closed.set_value();
+            return;
+        }
+        conn->setZeroCopyThreshold(64 * 1024);
+        conn->send(payload);
+        conn->forceClose();
+    });
+    server.start();
+
+    int fd = server.connect();
+    ASSERT_GE(fd, 0);
+    closed.get_future().wait();
+    // What the kernel took before the close is still sent, then the stream
+    // ends
+    auto received = test::readBytes(fd);
+    EXPECT_GT(received.size(), 0u);
+    EXPECT_TRUE(data.compare(0, received.size(), received) == 0);
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (payload.use_count() > 1 &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(1, payload.use_count());
+    close(fd);
+    server.stop();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -15,23 +15,35 @@
 #pragma once
 #include <trantor/utils/NonCopyable.h>
 #include <atomic>
+#include <thread>
 #include <type_traits>
 #include <memory>
+#include <new>
+#include <stdint.h>
 #include <assert.h>
 namespace trantor
 {
 /**
- * @brief This class template represents a lock-free multiple producers single
- * consumer queue
+ * @brief This class template represents a multiple producers single consumer
+ * queue
  *
  * @tparam T The type of the items in the queue.
+ * @note Items are stored in place in fixed-size segments which are linked
+ * together as the queue grows. Drained segments are kept for reuse, so a queue
+ * that is emptied regularly does not allocate on enqueue. Producers claim slots
+ * with atomic operations, but while the producer of the last slot of a segment
+ * links the next one, the other producers wait for it, so the queue is not
+ * lock-free.
  */
 template <typename T>
 class MpscQueue : public NonCopyable
 {
   public:
     MpscQueue()
-        : head_(new BufferNode), tail_(head_.load(std::memory_order_relaxed))
+        : tailIndex_(0),
+          tailSegment_(new Segment),
+          headSegment_(tailSegment_.load(std::memory_order_relaxed)),
+          spareSegments_(nullptr)
     {
     }
     ~MpscQueue()
@@ -40,27 +52,32 @@ class MpscQueue : public NonCopyable
         while (this->dequeue(output))
         {
         }
-        BufferNode *front = head_.load(std::memory_order_relaxed);
-        delete front;
+        // The head segment is the tail segment once the queue is drained.
+        delete headSegment_;
+        Segment *spare = spareSegments_.load(std::memory_order_relaxed);
+        while (spare)
+        {
+            Segment *next = spare->next_.load(std::memory_order_relaxed);
+            delete spare;
+            spare = next;
+        }
     }
 
     /**
      * @brief Put a item into the queue.
      *
      * @param input
-     * @note This method can be called in multiple threads.
+     * @note This method can be called in multiple threads. If the constructor
+     * of the item throws, the exception is passed on and the queue is left
+     * unchanged for the consumer.
      */
     void enqueue(T &&input)
     {
-        BufferNode *node{new BufferNode(std::move(input))};
-        BufferNode *prevhead{head_.exchange(node, std::memory_order_acq_rel)};
-        prevhead->next_.store(node, std::memory_order_release);
+        push(std::move(input));
     }
     void enqueue(const T &input)
     {
-        BufferNode *node{new BufferNode(input)};
-        BufferNode *prevhead{head_.exchange(node, std::memory_order_acq_rel)};
-        prevhead->next_.store(node, std::memory_order_release);
+        push(input);
     }
 
     /**
@@ -72,43 +89,186 @@ class MpscQueue : public NonCopyable
      */
     bool dequeue(T &output)
     {
-        BufferNode *tail = tail_.load(std::memory_order_relaxed);
-        BufferNode *next = tail->next_.load(std::memory_order_acquire);
-
-        if (next == nullptr)
+        if (!skipAbandonedSlots())
         {
             return false;
         }
-        output = std::move(*(next->dataPtr_));
-        delete next->dataPtr_;
-        tail_.store(next, std::memory_order_release);
-        delete tail;
+        Slot &slot = headSegment_->slots_[headOffset_];
+        T *data = slot.data();
+        output = std::move(*data);
+        data->~T();
+        popSlot(slot);
         return true;
     }
 
+    /**
+     * @note This method must be called in the consumer thread.
+     */
     bool empty()
     {
-        BufferNode *tail = tail_.load(std::memory_order_relaxed);
-        BufferNode *next = tail->next_.load(std::memory_order_acquire);
-        return next == nullptr;
+        return !skipAbandonedSlots();
     }
 
   private:
-    struct BufferNode
+    // One index value per lap is reserved to mark a segment which is full
+    // and whose successor is being linked.
+    static constexpr uint64_t kLap = 32;
+    static constexpr uint64_t kSegmentSize = kLap - 1;
+    // Drained segments kept for reuse, the rest are freed.
+    static constexpr size_t kMaxSpareSegments = 64;
+
+    enum SlotState : uint8_t
+    {
+        kEmpty,
+        kReady,
+        // The constructor of the item threw, the consumer skips the slot
+        kAbandoned
+    };
+    struct Slot
     {
-        BufferNode() = default;
-        BufferNode(const T &data) : dataPtr_(new T(data))
+        T *data()
         {
+            return reinterpret_cast<T *>(&storage_);
         }
-        BufferNode(T &&data) : dataPtr_(new T(std::move(data)))
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+        std::atomic<uint8_t> state_{kEmpty};
+    };
+    struct Segment
+    {
+        Slot slots_[kSegmentSize];
+        std::atomic<Segment *> next_{nullptr};
+    };
+
+    template <typename U>
+    void push(U &&input)
+    {
+        while (true)
         {
+            uint64_t tail = tailIndex_.load(std::memory_order_acquire);
+            uint64_t offset = tail % kLap;
+            if (offset == kSegmentSize)
+            {
+                // Another producer is linking the next segment.
+                std::this_thread::yield();
+                continue;
+            }
+            Segment *segment = tailSegment_.load(std::memory_order_acquire);
+            // The segment is only dereferenced after its slot is claimed, a
+            // claimed slot keeps the segment from being recycled.
+            if (!tailIndex_.compare_exchange_weak(tail,
+                                                  tail + 1,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed))
+            {
+                continue;
+            }
+            if (offset + 1 == kSegmentSize)
+            {
+                // Other producers wait until the next segment is linked, so
+                // only one thread at a time takes a spare segment.
+                Segment *next;
+                try
+                {
+                    next = acquireSegment();
+                }
+                catch (...)
+                {
+                    // Give the last slot back, so the waiting producers
+                    // retry instead of spinning forever
+                    tailIndex_.store(tail, std::memory_order_release);
+                    throw;
+                }
+                segment->next_.store(next, std::memory_order_release);
+                tailSegment_.store(next, std::memory_order_release);
+                tailIndex_.store(tail + 2, std::memory_order_release);
+            }
+            Slot &slot = segment->slots_[offset];
+            try
+            {
+                new (&slot.storage_) T(std::forward<U>(input));
+            }
+            catch (...)
+            {
+                // The slot is claimed already, the consumer must not wait for
+                // it
+                slot.state_.store(kAbandoned, std::memory_order_release);
+                throw;
+            }
+            slot.state_.store(kReady, std::memory_order_release);
+            return;
         }
-        T *dataPtr_;
-        std::atomic<BufferNode *> next_{nullptr};
-    };
+    }
+
+    // Returns true if the head slot holds an item
+    bool skipAbandonedSlots()
+    {
+        while (true)
+        {
+            Slot &slot = headSegment_->slots_[headOffset_];
+            auto state = slot.state_.load(std::memory_order_acquire);
+            if (state != kAbandoned)
+                return state == kReady;
+            popSlot(slot);
+        }
+    }
+    void popSlot(Slot &slot)
+    {
+        slot.state_.store(kEmpty, std::memory_order_relaxed);
+        if (++headOffset_ == kSegmentSize)
+        {
+            // The producer of the last slot links the next segment before
+            // publishing its item, so it is visible here.
+            Segment *next = headSegment_->next_.load(std::memory_order_acquire);
+            assert(next);
+            recycleSegment(headSegment_);
+            headSegment_ = next;
+            headOffset_ = 0;
+        }
+    }
+
+    Segment *acquireSegment()
+    {
+        Segment *segment = spareSegments_.load(std::memory_order_acquire);
+        while (segment)
+        {
+            // The consumer only pushes to the stack and there is only one
+            // popper at a time, so the top can't be popped and pushed back
+            // behind our back.
+            Segment *next = segment->next_.load(std::memory_order_relaxed);
+            if (spareSegments_.compare_exchange_weak(segment,
+                                                     next,
+                                                     std::memory_order_acquire,
+                                                     std::memory_order_acquire))
+            {
+                spareCount_.fetch_sub(1, std::memory_order_relaxed);
+                segment->next_.store(nullptr, std::memory_order_relaxed);
+                return segment;
+            }
+        }
+        return new Segment;
+    }
+    void recycleSegment(Segment *segment)
+    {
+        if (spareCount_.load(std::memory_order_relaxed) >= kMaxSpareSegments)
+        {
+            delete segment;
+            return;
+        }
+        spareCount_.fetch_add(1, std::memory_order_relaxed);
+        Segment *top = spareSegments_.load(std::memory_order_relaxed);
+        do
+        {
+            segment->next_.store(top, std::memory_order_relaxed);
+        } while (!spareSegments_.compare_exchange_weak(
+            top, segment, std::memory_order_release, std::memory_order_relaxed));
+    }
 
-    std::atomic<BufferNode *> head_;
-    std::atomic<BufferNode *> tail_;
+    std::atomic<uint64_t> tailIndex_;
+    std::atomic<Segment *> tailSegment_;
+    Segment *headSegment_;
+    uint64_t headOffset_{0};
+    std::atomic<Segment *> spareSegments_;
+    std::atomic<size_t> spareCount_{0};
 };
 
 }  // namespace trantor
@@ -0,0 +1,243 @@
+/**
+ *
+ *  @file MoveOnlyFunction.h
+ *  @author An Tao
+ *
+ *  Public header file in trantor lib.
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef TRANTOR_FUNC_INLINE_SIZE
+#define TRANTOR_FUNC_INLINE_SIZE 48
+#endif
+
+namespace trantor
+{
+template <typename Signature,
+          std::size_t InlineSize = TRANTOR_FUNC_INLINE_SIZE>
+class MoveOnlyFunction;
+
+/**
+ * @brief This class template represents a move-only callable wrapper, like
+ * std::function but with a larger inline buffer. Callables not larger than
+ * InlineSize bytes (for example a lambda capturing a couple of shared_ptrs) are
+ * stored in place without any heap allocation.
+ *
+ * @tparam R The return type.
+ * @tparam Args The argument types.
+ * @tparam InlineSize The size of the inline buffer in bytes, it can be set
+ * for the whole library with the TRANTOR_FUNC_INLINE_SIZE macro.
+ */
+template <typename R, typename... Args, std::size_t InlineSize>
+class MoveOnlyFunction<R(Args...), InlineSize>
+{
+    template <typename F>
+    using EnableIfCallable = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type,
+                      MoveOnlyFunction>::value &&
+        std::is_convertible<
+            decltype(std::declval<typename std::decay<F>::type &>()(
+                std::declval<Args>()...)),
+            R>::value>::type;
+
+  public:
+    MoveOnlyFunction() noexcept = default;
+    MoveOnlyFunction(std::nullptr_t) noexcept
+    {
+    }
+
+    /**
+     * @brief Construct a new instance from any callable object, including
+     * std::function objects. An empty std::function or a null function pointer
+     * results in an empty instance.
+     */
+    template <typename F, typename = EnableIfCallable<F>>
+    MoveOnlyFunction(F &&f)
+    {
+        using Fn = typename std::decay<F>::type;
+        if (isNull(f))
+            return;
+        construct<Fn>(std::forward<F>(f),
+                      std::integral_constant<bool, storedInline<Fn>()>());
+    }
+
+    MoveOnlyFunction(MoveOnlyFunction &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+    MoveOnlyFunction &operator=(MoveOnlyFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.ops_)
+            {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+    MoveOnlyFunction &operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+    template <typename F, typename = EnableIfCallable<F>>
+    MoveOnlyFunction &operator=(F &&f)
+    {
+        *this = MoveOnlyFunction(std::forward<F>(f));
+        return *this;
+    }
+    MoveOnlyFunction(const MoveOnlyFunction &) = delete;
+    MoveOnlyFunction &operator=(const MoveOnlyFunction &) = delete;
+
+    ~MoveOnlyFunction()
+    {
+        reset();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ops_ != nullptr;
+    }
+
+    /**
+     * @brief Call the stored callable.
+     * @note Calling an empty instance throws std::bad_function_call like
+     * std::function does.
+     */
+    R operator()(Args... args) const
+    {
+        if (!ops_)
+            throw std::bad_function_call();
+        return ops_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+  private:
+    using Storage =
+        typename std::aligned_storage<InlineSize,
+                                      alignof(std::max_align_t)>::type;
+    struct Ops
+    {
+        R (*invoke)(Storage *, Args &&...);
+        void (*move)(Storage *dst, Storage *src) noexcept;
+        void (*destroy)(Storage *) noexcept;
+    };
+
+    template <typename Fn>
+    static constexpr bool storedInline()
+    {
+        return sizeof(Fn) <= InlineSize &&
+               alignof(std::max_align_t) % alignof(Fn) == 0 &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template <typename Fn, typename F>
+    void construct(F &&f, std::true_type)
+    {
+        new (&storage_) Fn(std::forward<F>(f));
+        ops_ = inlineOps<Fn>();
+    }
+    template <typename Fn, typename F>
+    void construct(F &&f, std::false_type)
+    {
+        *reinterpret_cast<Fn **>(&storage_) = new Fn(std::forward<F>(f));
+        ops_ = heapOps<Fn>();
+    }
+
+    template <typename Fn>
+    static R invokeInline(Storage *s, Args &&...args)
+    {
+        return (*reinterpret_cast<Fn *>(s))(std::forward<Args>(args)...);
+    }
+    template <typename Fn>
+    static void moveInline(Storage *dst, Storage *src) noexcept
+    {
+        Fn *f = reinterpret_cast<Fn *>(src);
+        new (dst) Fn(std::move(*f));
+        f->~Fn();
+    }
+    template <typename Fn>
+    static void destroyInline(Storage *s) noexcept
+    {
+        reinterpret_cast<Fn *>(s)->~Fn();
+    }
+
+    template <typename Fn>
+    static R invokeHeap(Storage *s, Args &&...args)
+    {
+        return (**reinterpret_cast<Fn **>(s))(std::forward<Args>(args)...);
+    }
+    static void moveHeap(Storage *dst, Storage *src) noexcept
+    {
+        *reinterpret_cast<void **>(dst) = *reinterpret_cast<void **>(src);
+    }
+    template <typename Fn>
+    static void destroyHeap(Storage *s) noexcept
+    {
+        delete *reinterpret_cast<Fn **>(s);
+    }
+
+    template <typename Fn>
+    static const Ops *inlineOps()
+    {
+        static const Ops ops{&invokeInline<Fn>,
+                             &moveInline<Fn>,
+                             &destroyInline<Fn>};
+        return &ops;
+    }
+    template <typename Fn>
+    static const Ops *heapOps()
+    {
+        static const Ops ops{&invokeHeap<Fn>, &moveHeap, &destroyHeap<Fn>};
+        return &ops;
+    }
+
+    template <typename Fn>
+    static bool isNull(const Fn &)
+    {
+        return false;
+    }
+    template <typename Sig>
+    static bool isNull(const std::function<Sig> &f)
+    {
+        return !f;
+    }
+    template <typename Ret, typename... Params>
+    static bool isNull(Ret (*const &f)(Params...))
+    {
+        return f == nullptr;
+    }
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    mutable Storage storage_;
+    const Ops *ops_{nullptr};
+};
+
+}  // namespace trantor
@@ -18,6 +18,7 @@
 #ifndef _WIN32
 #include <sys/uio.h>
 #include <netinet/in.h>
+#include <sys/ioctl.h>
 #else
 #include <WindowsSupport.h>
 #include <winsock2.h>
@@ -29,7 +30,24 @@ using namespace trantor;
 namespace trantor
 {
 static constexpr size_t kBufferOffset{8};
+// The bounds of the room made for one read in readFd()
+static constexpr size_t kMinReadSize{1024};
+static constexpr size_t kMaxReadSize{256 * 1024};
+
+static size_t availableBytes(int fd)
+{
+#ifdef _WIN32
+    u_long n = 0;
+    if (::ioctlsocket(fd, FIONREAD, &n) != 0)
+        return 0;
+#else
+    int n = 0;
+    if (::ioctl(fd, FIONREAD, &n) < 0 || n < 0)
+        return 0;
+#endif
+    return static_cast<size_t>(n);
 }
+}  // namespace trantor
 
 MsgBuffer::MsgBuffer(size_t len)
     : head_(kBufferOffset), initCap_(len), buffer_(len + head_), tail_(head_)
@@ -56,6 +74,7 @@ void MsgBuffer::ensureWritableBytes(size_t len)
         newLen = kBufferOffset + readableBytes() + len;
     MsgBuffer newbuffer(newLen);
     newbuffer.append(*this);
+    newbuffer.readSizeAvg_ = readSizeAvg_;
     swap(newbuffer);
 }
 void MsgBuffer::swap(MsgBuffer &buf) noexcept
@@ -64,6 +83,7 @@ void MsgBuffer::swap(MsgBuffer &buf) noexcept
     std::swap(head_, buf.head_);
     std::swap(tail_, buf.tail_);
     std::swap(initCap_, buf.initCap_);
+    std::swap(readSizeAvg_, buf.readSizeAvg_);
 }
 void MsgBuffer::append(const MsgBuffer &buf)
 {
@@ -139,14 +159,37 @@ void MsgBuffer::retrieve(size_t len)
 }
 void MsgBuffer::retrieveAll()
 {
-    if (buffer_.size() > (initCap_ * 2))
+    // Don't give back the room the reads usually need, it would be allocated
+    // again by the next big read
+    size_t keepLen = (std::max)(initCap_, 2 * readSizeAvg_);
+    if (buffer_.size() > (keepLen * 2))
     {
-        buffer_.resize(initCap_);
+        buffer_.resize(keepLen);
+        buffer_.shrink_to_fit();
     }
     tail_ = head_ = kBufferOffset;
 }
 ssize_t MsgBuffer::readFd(int fd, int *retErrno)
 {
+    return readFd(fd, retErrno, false);
+}
+
+ssize_t MsgBuffer::readFd(int fd, int *retErrno, bool queryAvailable)
+{
+    size_t expected = readSizeAvg_ + readSizeAvg_ / 2;
+    if (queryAvailable)
+    {
+        size_t available = availableBytes(fd);
+        if (available > 0)
+            expected = available;
+    }
+    if (expected < kMinReadSize)
+        expected = kMinReadSize;
+    else if (expected > kMaxReadSize)
+        expected = kMaxReadSize;
+    ensureWritableBytes(expected);
+
+    // The stack buffer only takes the data beyond the expected size
     char extBuffer[8192];
     struct iovec vec[2];
     size_t writable = writableBytes();
@@ -159,8 +202,10 @@ ssize_t MsgBuffer::readFd(int fd, int *retErrno)
     if (n < 0)
     {
         *retErrno = errno;
+        return n;
     }
-    else if (static_cast<size_t>(n) <= writable)
+    readSizeAvg_ = (readSizeAvg_ * 7 + static_cast<size_t>(n)) / 8;
+    if (static_cast<size_t>(n) <= writable)
     {
         tail_ += n;
     }
@@ -228,5 +273,6 @@ void MsgBuffer::addInFront(const char *buf, size_t len)
     MsgBuffer newBuf(newLen);
     newBuf.append(buf, len);
     newBuf.append(*this);
+    newBuf.readSizeAvg_ = readSizeAvg_;
     swap(newBuf);
 }
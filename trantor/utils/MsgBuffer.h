@@ -266,7 +266,10 @@ class TRANTOR_EXPORT MsgBuffer
     void retrieve(size_t len);
 
     /**
-     * @brief Read data from a file descriptor and put it into the buffer.˝
+     * @brief Read data from a file descriptor and put it into the buffer.
+     * The buffer keeps an average of the sizes of the previous reads and makes
+     * room for that much data before reading, so the data is read straight
+     * into the buffer instead of through a temporary one.
      *
      * @param fd The file descriptor. It is usually a socket.
      * @param retErrno The error code when reading.
@@ -275,6 +278,19 @@ class TRANTOR_EXPORT MsgBuffer
      */
     ssize_t readFd(int fd, int *retErrno);
 
+    /**
+     * @brief Read data from a file descriptor and put it into the buffer.
+     *
+     * @param fd The file descriptor. It is usually a socket.
+     * @param retErrno The error code when reading.
+     * @param queryAvailable If true, the number of bytes ready to be read is
+     * got with the FIONREAD ioctl and used instead of the average, which
+     * costs one more system call per read.
+     * @return ssize_t The number of bytes read from the file descriptor. -1 is
+     * returned when an error occurs.
+     */
+    ssize_t readFd(int fd, int *retErrno, bool queryAvailable);
+
     /**
      * @brief Remove the data before a certain position from the buffer.
      *
@@ -351,6 +367,8 @@ class TRANTOR_EXPORT MsgBuffer
     size_t initCap_;
     std::vector<char> buffer_;
     size_t tail_;
+    // The moving average of the sizes of the reads in readFd()
+    size_t readSizeAvg_{0};
     const char *begin() const
     {
         return &buffer_[0];
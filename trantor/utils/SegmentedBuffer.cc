@@ -0,0 +1,296 @@
+/**
+ *
+ *  SegmentedBuffer.cc
+ *  An Tao
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  https://github.com/an-tao/trantor
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *  Trantor
+ *
+ */
+
+#include <trantor/utils/SegmentedBuffer.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <limits.h>
+#else
+#include <WindowsSupport.h>
+#endif
+#include <errno.h>
+#include <assert.h>
+
+using namespace trantor;
+namespace trantor
+{
+// The number of free blocks kept for reuse, readFd() reads into as many new
+// blocks at most
+static constexpr size_t kMaxSpareBlocks{2};
+}  // namespace trantor
+
+SegmentedBuffer::SegmentedBuffer(size_t blockSize) : blockSize_(blockSize)
+{
+    assert(blockSize_ > 0);
+}
+
+size_t SegmentedBuffer::segmentCount() const
+{
+    size_t count = 0;
+    for (auto &block : blocks_)
+    {
+        if (block.tail_ > block.head_)
+            ++count;
+    }
+    return count;
+}
+
+size_t SegmentedBuffer::getSegments(const char **data,
+                                    size_t *len,
+                                    size_t maxCount) const
+{
+    size_t count = 0;
+    for (auto &block : blocks_)
+    {
+        if (count == maxCount)
+            break;
+        if (block.tail_ == block.head_)
+            continue;
+        data[count] = block.data_.get() + block.head_;
+        len[count] = block.tail_ - block.head_;
+        ++count;
+    }
+    return count;
+}
+
+void SegmentedBuffer::peekSegment(const char *&data, size_t &len) const
+{
+    if (getSegments(&data, &len, 1) == 0)
+    {
+        data = nullptr;
+        len = 0;
+    }
+}
+
+const char *SegmentedBuffer::linearize()
+{
+    if (readableBytes_ == 0)
+        return nullptr;
+    auto &front = blocks_.front();
+    if (front.tail_ - front.head_ == readableBytes_)
+        return front.data_.get() + front.head_;
+    Block block = newBlock(readableBytes_);
+    for (auto &b : blocks_)
+    {
+        memcpy(block.data_.get() + block.tail_,
+               b.data_.get() + b.head_,
+               b.tail_ - b.head_);
+        block.tail_ += b.tail_ - b.head_;
+    }
+    while (!blocks_.empty())
+    {
+        recycleBlock(std::move(blocks_.front()));
+        blocks_.pop_front();
+    }
+    blocks_.push_back(std::move(block));
+    return blocks_.front().data_.get();
+}
+
+void SegmentedBuffer::append(const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        if (blocks_.empty() ||
+            blocks_.back().tail_ == blocks_.back().capacity_)
+        {
+            // Small buffers start with a small block, the blocks double in
+            // size up to the block size
+            size_t capacity =
+                blocks_.empty() ? kBufferDefaultLength
+                                : 2 * blocks_.back().capacity_;
+            if (capacity < len)
+                capacity = len;
+            if (capacity > blockSize_)
+                capacity = blockSize_;
+            blocks_.push_back(newBlock(capacity));
+        }
+        auto &block = blocks_.back();
+        size_t n = std::min(len, block.capacity_ - block.tail_);
+        memcpy(block.data_.get() + block.tail_, buf, n);
+        block.tail_ += n;
+        readableBytes_ += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+void SegmentedBuffer::addInFront(const char *buf, size_t len)
+{
+    if (len == 0)
+        return;
+    if (blocks_.empty() || blocks_.front().head_ < len)
+    {
+        Block block = newBlock(len);
+        block.head_ = block.tail_ = block.capacity_;
+        blocks_.push_front(std::move(block));
+    }
+    auto &front = blocks_.front();
+    front.head_ -= len;
+    memcpy(front.data_.get() + front.head_, buf, len);
+    readableBytes_ += len;
+}
+
+void SegmentedBuffer::retrieve(size_t len)
+{
+    if (len >= readableBytes_)
+    {
+        retrieveAll();
+        return;
+    }
+    readableBytes_ -= len;
+    while (len > 0)
+    {
+        auto &front = blocks_.front();
+        size_t n = std::min(len, front.tail_ - front.head_);
+        front.head_ += n;
+        len -= n;
+        if (front.head_ == front.tail_)
+        {
+            recycleBlock(std::move(front));
+            blocks_.pop_front();
+        }
+    }
+}
+
+void SegmentedBuffer::retrieveAll()
+{
+    // The first block is kept for new data
+    while (blocks_.size() > 1)
+    {
+        recycleBlock(std::move(blocks_.back()));
+        blocks_.pop_back();
+    }
+    if (!blocks_.empty())
+        blocks_.front().head_ = blocks_.front().tail_ = 0;
+    readableBytes_ = 0;
+}
+
+ssize_t SegmentedBuffer::readFd(int fd, int *retErrno)
+{
+    struct iovec vecs[kMaxSpareBlocks + 1];
+    int count = 0;
+    size_t tailSpace = 0;
+    if (!blocks_.empty())
+    {
+        auto &back = blocks_.back();
+        tailSpace = back.capacity_ - back.tail_;
+        if (tailSpace > 0)
+        {
+            vecs[count].iov_base = back.data_.get() + back.tail_;
+            vecs[count].iov_len = static_cast<decltype(vecs[count].iov_len)>(
+                tailSpace);
+            ++count;
+        }
+    }
+    while (spareBlocks_.size() < kMaxSpareBlocks)
+    {
+        Block block;
+        block.data_.reset(new char[blockSize_]);
+        block.capacity_ = blockSize_;
+        spareBlocks_.push_back(std::move(block));
+    }
+    for (size_t i = 0; i < kMaxSpareBlocks; ++i)
+    {
+        auto &block = spareBlocks_[spareBlocks_.size() - 1 - i];
+        vecs[count].iov_base = block.data_.get();
+        vecs[count].iov_len =
+            static_cast<decltype(vecs[count].iov_len)>(block.capacity_);
+        ++count;
+    }
+    ssize_t n = ::readv(fd, vecs, count);
+    if (n < 0)
+    {
+        *retErrno = errno;
+        return n;
+    }
+    size_t left = static_cast<size_t>(n);
+    readableBytes_ += left;
+    size_t inTail = std::min(left, tailSpace);
+    if (inTail > 0)
+    {
+        blocks_.back().tail_ += inTail;
+        left -= inTail;
+    }
+    // Link the spare blocks which received data
+    while (left > 0)
+    {
+        Block block = std::move(spareBlocks_.back());
+        spareBlocks_.pop_back();
+        block.tail_ = std::min(left, block.capacity_);
+        left -= block.tail_;
+        blocks_.push_back(std::move(block));
+    }
+    return n;
+}
+
+#ifndef _WIN32
+ssize_t SegmentedBuffer::writeFd(int fd, int *retErrno)
+{
+#ifdef IOV_MAX
+    static constexpr size_t kMaxIovecs = IOV_MAX < 64 ? IOV_MAX : 64;
+#else
+    static constexpr size_t kMaxIovecs = 16;
+#endif
+    const char *data[kMaxIovecs];
+    size_t len[kMaxIovecs];
+    struct iovec vecs[kMaxIovecs];
+    size_t count = getSegments(data, len, kMaxIovecs);
+    if (count == 0)
+        return 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        vecs[i].iov_base = const_cast<char *>(data[i]);
+        vecs[i].iov_len = len[i];
+    }
+    ssize_t n = ::writev(fd, vecs, static_cast<int>(count));
+    if (n < 0)
+    {
+        *retErrno = errno;
+        return n;
+    }
+    retrieve(static_cast<size_t>(n));
+    return n;
+}
+#endif
+
+void SegmentedBuffer::swap(SegmentedBuffer &buf) noexcept
+{
+    blocks_.swap(buf.blocks_);
+    spareBlocks_.swap(buf.spareBlocks_);
+    std::swap(readableBytes_, buf.readableBytes_);
+    std::swap(blockSize_, buf.blockSize_);
+}
+
+SegmentedBuffer::Block SegmentedBuffer::newBlock(size_t capacity)
+{
+    if (capacity == blockSize_ && !spareBlocks_.empty())
+    {
+        Block block = std::move(spareBlocks_.back());
+        spareBlocks_.pop_back();
+        return block;
+    }
+    Block block;
+    block.data_.reset(new char[capacity]);
+    block.capacity_ = capacity;
+    return block;
+}
+
+void SegmentedBuffer::recycleBlock(Block &&block)
+{
+    if (block.capacity_ != blockSize_ || spareBlocks_.size() >= kMaxSpareBlocks)
+        return;
+    block.head_ = block.tail_ = 0;
+    spareBlocks_.push_back(std::move(block));
+}
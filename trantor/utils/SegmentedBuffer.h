@@ -0,0 +1,183 @@
+/**
+ *
+ *  @file SegmentedBuffer.h
+ *  @author An Tao
+ *
+ *  Public header file in trantor lib.
+ *
+ *  Copyright 2018, An Tao.  All rights reserved.
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the License file.
+ *
+ *
+ */
+
+#pragma once
+#include <trantor/utils/MsgBuffer.h>
+#include <trantor/exports.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace trantor
+{
+/**
+ * @brief This class represents a memory buffer made of a chain of blocks.
+ * Unlike MsgBuffer, the data is never moved to a larger buffer when the buffer
+ * grows, new blocks are linked instead, so appending or reading megabytes of
+ * data costs no reallocation copies. The data can be read and written with
+ * readv()/writev() directly from and to the blocks.
+ *
+ */
+class TRANTOR_EXPORT SegmentedBuffer
+{
+  public:
+    static constexpr size_t kDefaultBlockSize{16 * 1024};
+
+    /**
+     * @brief Construct a new segmented buffer instance.
+     *
+     * @param blockSize The size of the blocks. The first blocks of a buffer
+     * may be smaller, they grow up to this size.
+     */
+    explicit SegmentedBuffer(size_t blockSize = kDefaultBlockSize);
+
+    SegmentedBuffer(SegmentedBuffer &&) noexcept = default;
+    SegmentedBuffer &operator=(SegmentedBuffer &&) noexcept = default;
+    SegmentedBuffer(const SegmentedBuffer &) = delete;
+    SegmentedBuffer &operator=(const SegmentedBuffer &) = delete;
+
+    /**
+     * @brief Return the size of the data in the buffer.
+     *
+     * @return size_t
+     */
+    size_t readableBytes() const
+    {
+        return readableBytes_;
+    }
+
+    /**
+     * @brief Return the number of blocks holding data.
+     *
+     * @return size_t
+     */
+    size_t segmentCount() const;
+
+    /**
+     * @brief Get the data of the blocks, from the beginning of the buffer.
+     *
+     * @param data The start addresses of the segments.
+     * @param len The lengths of the segments.
+     * @param maxCount The size of the arrays.
+     * @return size_t The number of segments got.
+     */
+    size_t getSegments(const char **data, size_t *len, size_t maxCount) const;
+
+    /**
+     * @brief Get the data in the first block.
+     *
+     * @param data
+     * @param len
+     */
+    void peekSegment(const char *&data, size_t &len) const;
+
+    /**
+     * @brief Get all the data as one contiguous piece of memory. The data is
+     * moved to a single block if it spans several blocks.
+     *
+     * @return const char* NULL if the buffer is empty.
+     */
+    const char *linearize();
+
+    /**
+     * @brief Append new data to the buffer.
+     *
+     */
+    void append(const char *buf, size_t len);
+    void append(const std::string &buf)
+    {
+        append(buf.data(), buf.length());
+    }
+    void append(const MsgBuffer &buf)
+    {
+        append(buf.peek(), buf.readableBytes());
+    }
+
+    /**
+     * @brief Put new data to the beginning of the buffer, a block is linked in
+     * front of the data if the first block has no room.
+     *
+     * @param buf
+     * @param len
+     */
+    void addInFront(const char *buf, size_t len);
+
+    /**
+     * @brief Remove some bytes in the buffer.
+     *
+     * @param len
+     */
+    void retrieve(size_t len);
+
+    /**
+     * @brief Remove all data in the buffer.
+     *
+     */
+    void retrieveAll();
+
+    /**
+     * @brief Read data from a file descriptor into the free space of the last
+     * block and a few new blocks with one readv() call.
+     *
+     * @param fd The file descriptor. It is usually a socket.
+     * @param retErrno The error code when reading.
+     * @return ssize_t The number of bytes read from the file descriptor. -1 is
+     * returned when an error occurs.
+     */
+    ssize_t readFd(int fd, int *retErrno);
+
+#ifndef _WIN32
+    /**
+     * @brief Write the data to a file descriptor with one writev() call and
+     * remove the written bytes from the buffer.
+     *
+     * @param fd The file descriptor. It is usually a socket.
+     * @param retErrno The error code when writing.
+     * @return ssize_t The number of bytes written. -1 is returned when an
+     * error occurs.
+     */
+    ssize_t writeFd(int fd, int *retErrno);
+#endif
+
+    /**
+     * @brief swap the buffer with another.
+     *
+     * @param buf
+     */
+    void swap(SegmentedBuffer &buf) noexcept;
+
+  private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data_;
+        size_t capacity_{0};
+        size_t head_{0};
+        size_t tail_{0};
+    };
+    Block newBlock(size_t capacity);
+    void recycleBlock(Block &&block);
+
+    std::deque<Block> blocks_;
+    // Free full size blocks kept for the next reads
+    std::vector<Block> spareBlocks_;
+    size_t readableBytes_{0};
+    size_t blockSize_;
+};
+
+inline void swap(SegmentedBuffer &one, SegmentedBuffer &two) noexcept
+{
+    one.swap(two);
+}
+}  // namespace trantor